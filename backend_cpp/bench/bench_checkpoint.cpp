@@ -0,0 +1,81 @@
+// Checkpoint cost for 1k/10k/100k vehicles: encoding on the simulation
+// thread versus writing the file (done on the writer thread), plus a check
+// that reading it back restores the same state.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bench_checkpoint
+#include "checkpoint.h"
+#include "topology.h"
+#include "vehicle_store.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+const double kDeltaTime = 0.1;
+const char* const kPath = "bench_checkpoint.ckpt";
+
+std::shared_ptr<const Topology> makeCity() {
+    std::mt19937 rng(42);
+    std::vector<Stop> stops;
+    for (int i = 0; i < 2500; ++i) {
+        stops.push_back({i + 1, "Stop", (i % 50) * 40.0 + rng() % 20, (i / 50) * 40.0 + rng() % 20});
+    }
+    std::vector<Route> routes;
+    for (int r = 0; r < 300; ++r) {
+        Route route{r + 1, "Route", "bus", {}};
+        for (int s = 0; s < 15; ++s) {
+            route.stop_ids.push_back(rng() % stops.size() + 1);
+        }
+        routes.push_back(route);
+    }
+    return Topology::build(stops, routes);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    auto city = makeCity();
+    VehicleInfo info{intern("Route"), intern("bus")};
+
+    std::printf("%10s %10s %12s %12s %10s\n", "vehicles", "bytes", "encode ms", "write ms", "restored");
+    for (int count : {1000, 10000, 100000}) {
+        std::mt19937 rng(7);
+        VehicleStore store;
+        store.reserve(count);
+        for (int id = 1; id <= count; ++id) {
+            store.add(id, rng() % city->routeCount(), *city, 20.0 + rng() % 25, vehicleKindFor("bus"), info);
+        }
+        for (int tick = 0; tick < 600; ++tick) {
+            store.advance(*city, kDeltaTime);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<char> image = Checkpoint::encode(store, *city, 600, 60.0);
+        double encode_ms = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        bool written = Checkpoint::write(kPath, image);
+        double write_ms = millisecondsSince(start);
+
+        Checkpoint saved;
+        bool identical = written && Checkpoint::read(kPath, saved) &&
+                         saved.vehicles.size() == store.size();
+        for (size_t i = 0; identical && i < store.size(); ++i) {
+            const VehicleCheckpoint& vehicle = saved.vehicles[i];
+            identical = vehicle.vehicle_id == store.vehicle_id[i] &&
+                        vehicle.stop_idx == store.stop_idx[i] &&
+                        vehicle.travelled == store.travelled[i] && vehicle.dwell == store.dwell[i] &&
+                        vehicle.velocity == store.velocity[i] && vehicle.rng == store.rng[i];
+        }
+
+        std::printf("%10d %10zu %12.3f %12.3f %10s\n", count, image.size(), encode_ms, write_ms,
+                    identical ? "yes" : "NO");
+    }
+    std::remove(kPath);
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Database access cost: point lookups and full-table loads through cached
+// prepared statements and typed column reads, versus the original SQL text
+// run by sqlite3_exec with text callbacks, plus upserts of names that need
+// quoting, and a 500-stop route written statement by statement versus in
+// one transaction, and getStopById throughput from 1-8 threads through the
+// reader pool versus a pool of one. The stops table holds a million rows,
+// 1000 routes 20 stops each.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bench_database
+#include "database.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+const char* const kPath = "bench_database.db";
+const int kStops = 1000000;
+const int kRoutes = 1000;
+const int kStopsPerRoute = 20;
+const int kLookups = 20000;
+
+double microsecondsPer(std::chrono::steady_clock::time_point start, int calls) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+// Bulk load through a connection of our own, in one transaction
+void fill() {
+    sqlite3* db = nullptr;
+    sqlite3_open(kPath, &db);
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    std::mt19937 rng(42);
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO stops (name, x, y) VALUES (?, ?, ?);", -1, &insert, nullptr);
+    for (int i = 1; i <= kStops; ++i) {
+        std::string name = "Stop " + std::to_string(i);
+        sqlite3_bind_text(insert, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(insert, 2, rng() % 100000 / 100.0);
+        sqlite3_bind_double(insert, 3, rng() % 100000 / 100.0);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    for (int r = 1; r <= kRoutes; ++r) {
+        std::ostringstream oss;
+        oss << "INSERT INTO routes (name, type) VALUES ('Route " << r << "', 'bus');";
+        for (int s = 0; s < kStopsPerRoute; ++s) {
+            oss << "INSERT INTO route_stops (route_id, stop_id, order_index) VALUES (" << r + 5 << ", "
+                << rng() % kStops + 1 << ", " << s << ");";
+        }
+        oss << "INSERT INTO vehicles (route_id, type, avg_speed, route_name) VALUES (" << r + 5
+            << ", 'bus', 30, 'Route " << r << "');";
+        sqlite3_exec(db, oss.str().c_str(), nullptr, nullptr, nullptr);
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+}
+
+// getStopById as it was: SQL text per call, text callback
+Stop legacyStopById(sqlite3* db, int id) {
+    Stop stop = {0, "", 0.0, 0.0};
+    std::ostringstream oss;
+    oss << "SELECT id, name, x, y FROM stops WHERE id = " << id << ";";
+    auto callback = [](void* data, int, char** argv, char**) -> int {
+        Stop* stop = static_cast<Stop*>(data);
+        stop->id = std::stoi(argv[0]);
+        stop->name = argv[1];
+        stop->x = std::stod(argv[2]);
+        stop->y = std::stod(argv[3]);
+        return 0;
+    };
+    sqlite3_exec(db, oss.str().c_str(), callback, &stop, nullptr);
+    return stop;
+}
+
+// getAllStops as it was: every column formatted to text and parsed back
+std::vector<Stop> legacyAllStops(sqlite3* db) {
+    std::vector<Stop> stops;
+    auto callback = [](void* data, int, char** argv, char**) -> int {
+        std::vector<Stop>* stops = static_cast<std::vector<Stop>*>(data);
+        Stop stop;
+        stop.id = std::stoi(argv[0]);
+        stop.name = argv[1];
+        stop.x = std::stod(argv[2]);
+        stop.y = std::stod(argv[3]);
+        stops->push_back(stop);
+        return 0;
+    };
+    sqlite3_exec(db, "SELECT id, name, x, y FROM stops ORDER BY id;", callback, &stops, nullptr);
+    return stops;
+}
+
+// getAllRoutes as it was: the routes, then one query per route for its stops
+std::vector<Route> legacyAllRoutes(sqlite3* db) {
+    std::vector<Route> routes;
+    auto route_callback = [](void* data, int, char** argv, char**) -> int {
+        static_cast<std::vector<Route>*>(data)->push_back({std::stoi(argv[0]), argv[1], argv[2], {}});
+        return 0;
+    };
+    sqlite3_exec(db, "SELECT id, name, type FROM routes ORDER BY id;", route_callback, &routes, nullptr);
+    auto stop_callback = [](void* data, int, char** argv, char**) -> int {
+        static_cast<Route*>(data)->stop_ids.push_back(std::stoi(argv[0]));
+        return 0;
+    };
+    for (auto& route : routes) {
+        std::string sql = "SELECT stop_id FROM route_stops WHERE route_id = " + std::to_string(route.id) +
+                          " ORDER BY order_index;";
+        sqlite3_exec(db, sql.c_str(), stop_callback, &route, nullptr);
+    }
+    return routes;
+}
+
+// createOrUpdateRoute as it was: every statement its own transaction
+void legacyWriteRoute(sqlite3* db, const Route& route) {
+    std::string sql = "UPDATE routes SET name = '" + route.name + "' WHERE id = " + std::to_string(route.id) + ";";
+    sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    sql = "DELETE FROM route_stops WHERE route_id = " + std::to_string(route.id) + ";";
+    sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    for (size_t i = 0; i < route.stop_ids.size(); ++i) {
+        sql = "INSERT INTO route_stops (route_id, stop_id, order_index) VALUES (" + std::to_string(route.id) +
+              ", " + std::to_string(route.stop_ids[i]) + ", " + std::to_string(i) + ");";
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Lookups per second with every thread running all of ids
+double lookupsPerSecond(Database& database, const std::vector<int>& ids, int threads) {
+    std::vector<std::thread> workers;
+    std::vector<double> sums(threads, 0.0);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int id : ids) {
+                sums[t] += database.getStopById(id).x;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return threads * ids.size() / (millisecondsSince(start) / 1000.0);
+}
+
+// WAL mode leaves -wal and -shm files next to the database while it is open
+void removeDatabase() {
+    std::string path = kPath;
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+int run() {
+    Database database(kPath);
+    if (!database.initialize()) return 1;
+    fill();
+
+    std::mt19937 rng(7);
+    std::vector<int> ids(kLookups);
+    for (int& id : ids) {
+        id = rng() % kStops + 1;
+    }
+
+    sqlite3* legacy = nullptr;
+    sqlite3_open(kPath, &legacy);
+    double checksum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int id : ids) {
+        checksum += legacyStopById(legacy, id).x;
+    }
+    double legacy_us = microsecondsPer(start, kLookups);
+
+    start = std::chrono::steady_clock::now();
+    size_t legacy_rows = legacyAllStops(legacy).size();
+    double legacy_load_ms = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<Route> legacy_routes = legacyAllRoutes(legacy);
+    double legacy_routes_ms = millisecondsSince(start);
+    sqlite3_close(legacy);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<Route> routes = database.getAllRoutes();
+    double routes_ms = millisecondsSince(start);
+    bool same_routes = routes.size() == legacy_routes.size();
+    for (size_t r = 0; same_routes && r < routes.size(); ++r) {
+        same_routes = routes[r].id == legacy_routes[r].id && routes[r].stop_ids == legacy_routes[r].stop_ids;
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<Stop> all = database.getAllStops();
+    double load_ms = millisecondsSince(start);
+    bool same_rows = all.size() == legacy_rows;
+
+    start = std::chrono::steady_clock::now();
+    for (int id : ids) {
+        checksum -= database.getStopById(id).x;
+    }
+    double stop_us = microsecondsPer(start, kLookups);
+
+    start = std::chrono::steady_clock::now();
+    for (int id : ids) {
+        checksum += database.getVehicleById(id % kRoutes + 9).avg_speed;
+    }
+    double vehicle_us = microsecondsPer(start, kLookups);
+
+    start = std::chrono::steady_clock::now();
+    for (int id : ids) {
+        checksum += database.getRouteStops(id % kRoutes + 6).size();
+    }
+    double route_stops_us = microsecondsPer(start, kLookups);
+
+    // Each upsert is its own transaction, so this is mostly the disk sync
+    const int upserts = 200;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < upserts; ++i) {
+        database.createOrUpdateStop({ids[i], "O'Brien Street", 1.0 * i, 2.0 * i});
+    }
+    double upsert_us = microsecondsPer(start, upserts);
+    bool quoted = database.getStopById(ids[0]).name == "O'Brien Street";
+
+    Route long_route{6, "Long route", "bus", {}};
+    for (int s = 0; s < 500; ++s) {
+        long_route.stop_ids.push_back(ids[s]);
+    }
+    sqlite3_open(kPath, &legacy);
+    start = std::chrono::steady_clock::now();
+    legacyWriteRoute(legacy, long_route);
+    double legacy_route_ms = millisecondsSince(start);
+    sqlite3_close(legacy);
+
+    start = std::chrono::steady_clock::now();
+    bool route_written = database.createOrUpdateRoute(long_route) &&
+                         database.getRouteById(6).stop_ids == long_route.stop_ids;
+    double route_ms = millisecondsSince(start);
+
+    std::printf("%-32s %10.2f us\n", "getStopById (SQL text, exec)", legacy_us);
+    std::printf("%-32s %10.2f us\n", "getStopById (prepared)", stop_us);
+    std::printf("%-32s %10.2f us\n", "getVehicleById (prepared)", vehicle_us);
+    std::printf("%-32s %10.2f us\n", "getRouteStops (prepared)", route_stops_us);
+    std::printf("%-32s %10.1f ms\n", "all stops (exec, text callback)", legacy_load_ms);
+    std::printf("%-32s %10.1f ms   rows %s\n", "getAllStops (typed rows)", load_ms, same_rows ? "ok" : "DIFFER");
+    std::printf("%-32s %10.1f ms\n", "all routes (query per route)", legacy_routes_ms);
+    std::printf("%-32s %10.1f ms   routes %s\n", "getAllRoutes (one join)", routes_ms,
+                same_routes ? "ok" : "DIFFER");
+    std::printf("%-32s %10.2f us   quoting %s\n", "createOrUpdateStop", upsert_us, quoted ? "ok" : "BROKEN");
+    std::printf("%-32s %10.1f ms\n", "500-stop route (autocommit)", legacy_route_ms);
+    std::printf("%-32s %10.1f ms   stops %s\n", "createOrUpdateRoute (500 stops)", route_ms,
+                route_written ? "ok" : "DIFFER");
+
+    // A pool of one serializes every lookup, as the single connection did
+    Database single(kPath, 1);
+    single.initialize();
+    for (int threads : {1, 2, 4, 8}) {
+        std::printf("getStopById x%d threads %14.0f/s (pool)  %10.0f/s (one reader)\n", threads,
+                    lookupsPerSecond(database, ids, threads), lookupsPerSecond(single, ids, threads));
+    }
+    std::printf("checksum %.1f\n", checksum);
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    removeDatabase();
+    int result = run();
+    removeDatabase();
+    return result;
+}
@@ -0,0 +1,94 @@
+// Vehicle motion kernel throughput per SIMD level (scalar, SSE2, AVX2),
+// plus a check that every level produces bit-identical state.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bench_kinematics
+#include "kinematics.h"
+#include "topology.h"
+#include "vehicle_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace {
+
+const double kDeltaTime = 0.1;
+const int kVehicles = 100000;
+const int kTicks = 200;
+
+std::shared_ptr<const Topology> makeCity() {
+    std::mt19937 rng(42);
+    std::vector<Stop> stops;
+    for (int i = 0; i < 2500; ++i) {
+        stops.push_back({i + 1, "Stop", (i % 50) * 40.0 + rng() % 20, (i / 50) * 40.0 + rng() % 20});
+    }
+    std::vector<Route> routes;
+    for (int r = 0; r < 300; ++r) {
+        Route route{r + 1, "Route", "bus", {}};
+        for (int s = 0; s < 15; ++s) {
+            route.stop_ids.push_back(rng() % stops.size() + 1);
+        }
+        routes.push_back(route);
+    }
+    return Topology::build(stops, routes);
+}
+
+VehicleStore makeFleet(const Topology& city, VehicleInfo info) {
+    std::mt19937 rng(7);
+    VehicleStore store;
+    store.reserve(kVehicles);
+    for (int id = 1; id <= kVehicles; ++id) {
+        // Slow vehicles so most ticks take the move branch rather than arrive
+        double speed = 0.5 + (rng() % 100) * 0.05;
+        store.add(id, rng() % city.routeCount(), city, speed, vehicleKindFor("bus"), info);
+    }
+    return store;
+}
+
+bool sameBits(const std::vector<double>& a, const std::vector<double>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+} // namespace
+
+int main() {
+    auto city = makeCity();
+    VehicleInfo info{intern("Route"), intern("bus")};
+
+    std::printf("cpu best level: %s\n", simdLevelName(detectSimdLevel()));
+    std::printf("%8s %18s %9s %10s\n", "level", "vehicle-updates/s", "speedup", "identical");
+
+    VehicleStore reference;
+    double scalar_rate = 0.0;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if (level > detectSimdLevel()) {
+            std::printf("%8s %18s\n", simdLevelName(level), "unsupported");
+            continue;
+        }
+
+        VehicleStore store = makeFleet(*city, info);
+        store.setSimdLevel(level);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < kTicks; ++tick) {
+            store.advance(*city, kDeltaTime);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = static_cast<double>(kVehicles) * kTicks / elapsed;
+
+        bool identical = true;
+        if (level == SimdLevel::Scalar) {
+            scalar_rate = rate;
+            reference = store;
+        } else {
+            identical = sameBits(store.x, reference.x) && sameBits(store.y, reference.y) &&
+                        sameBits(store.progress, reference.progress) &&
+                        sameBits(store.dwell, reference.dwell) && sameBits(store.velocity, reference.velocity) &&
+                        store.stop_idx == reference.stop_idx;
+        }
+
+        std::printf("%8s %18.3e %8.2fx %10s\n", simdLevelName(level), rate, rate / scalar_rate,
+                    identical ? "yes" : "NO");
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Tick throughput of the structure-of-arrays VehicleStore versus the
+// original std::map<int, VehicleState> layout, for 1k/10k/100k vehicles.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./bench_tick
+#include "topology.h"
+#include "vehicle_store.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <algorithm>
+
+namespace {
+
+const double kDeltaTime = 0.1;
+const double kMinBenchSeconds = 0.5;
+
+// Synthetic city: a square grid of stops and random-walk routes across it
+std::shared_ptr<const Topology> makeCity(int grid, int route_count, int stops_per_route) {
+    std::mt19937 rng(42);
+    std::vector<Stop> stops;
+    for (int i = 0; i < grid * grid; ++i) {
+        stops.push_back({i + 1, "Stop " + std::to_string(i + 1),
+                         (i % grid) * 10.0, (i / grid) * 10.0});
+    }
+
+    std::vector<Route> routes;
+    for (int r = 0; r < route_count; ++r) {
+        Route route{r + 1, "Route " + std::to_string(r + 1), "bus", {}};
+        int cx = rng() % grid;
+        int cy = rng() % grid;
+        for (int s = 0; s < stops_per_route; ++s) {
+            route.stop_ids.push_back(cy * grid + cx + 1);
+            if (rng() % 2) {
+                cx = std::clamp(cx + (rng() % 2 ? 1 : -1), 0, grid - 1);
+            } else {
+                cy = std::clamp(cy + (rng() % 2 ? 1 : -1), 0, grid - 1);
+            }
+        }
+        routes.push_back(route);
+    }
+    return Topology::build(stops, routes);
+}
+
+// The original virtual model interface, allocated once per vehicle
+class LegacyModel {
+public:
+    explicit LegacyModel(double dwell_time) : dwell_time_(dwell_time) {}
+    virtual ~LegacyModel() = default;
+    virtual double getDwellTime() const { return dwell_time_; }
+
+private:
+    double dwell_time_;
+};
+
+// The pre-SoA layout: one red-black tree node per vehicle, each holding its
+// own copy of the route's stop ids and a refcounted model
+struct LegacyState {
+    int vehicle_id;
+    int route_id;
+    std::vector<int> stop_ids;
+    int current_stop_idx;
+    double x;
+    double y;
+    double target_x;
+    double target_y;
+    double speed;
+    double progress;
+    bool forward;
+    double dwell_time;
+    std::shared_ptr<LegacyModel> model;
+};
+
+void legacyUpdate(LegacyState& state, const Topology& topology, double delta_time) {
+    if (state.dwell_time > 0.0) {
+        state.dwell_time -= delta_time;
+        return;
+    }
+
+    const int stop_count = static_cast<int>(state.stop_ids.size());
+    double dx = state.target_x - state.x;
+    double dy = state.target_y - state.y;
+    double distance = std::sqrt(dx * dx + dy * dy);
+    double speed_units_per_sec = (state.speed / 3.6) / 0.1;
+
+    if (distance < 0.5) {
+        state.x = state.target_x;
+        state.y = state.target_y;
+        state.progress = 0.0;
+        state.dwell_time = state.model->getDwellTime();
+        state.current_stop_idx = (state.current_stop_idx + 1) % stop_count;
+        int next_idx = (state.current_stop_idx + 1) % stop_count;
+        const auto& next = topology.stop(state.stop_ids[next_idx]);
+        state.target_x = next.x;
+        state.target_y = next.y;
+    } else {
+        double ratio = std::min(1.0, speed_units_per_sec * delta_time / distance);
+        state.x += dx * ratio;
+        state.y += dy * ratio;
+        const auto& start = topology.stop(state.stop_ids[state.current_stop_idx]);
+        double total_distance = std::sqrt(
+            std::pow(state.target_x - start.x, 2) +
+            std::pow(state.target_y - start.y, 2));
+        state.progress = std::min(1.0, std::max(0.0, (total_distance - distance) / total_distance));
+    }
+}
+
+template <typename TickFn>
+double ticksPerSecond(TickFn tick) {
+    using clock = std::chrono::steady_clock;
+    long ticks = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        tick();
+        ++ticks;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < kMinBenchSeconds);
+    return ticks / elapsed;
+}
+
+} // namespace
+
+int main() {
+    auto city = makeCity(100, 500, 20);
+
+    std::printf("%10s %16s %16s %9s\n", "vehicles", "map ticks/s", "SoA ticks/s", "speedup");
+    for (int count : {1000, 10000, 100000}) {
+        std::mt19937 rng(7);
+
+        VehicleStore store;
+        store.reserve(count);
+        std::map<int, LegacyState> legacy;
+
+        for (int id = 1; id <= count; ++id) {
+            int route = rng() % city->routeCount();
+            double speed = 20.0 + rng() % 25;
+            const char* type = (id % 3 == 0) ? "tram" : (id % 3 == 1) ? "bus" : "trolleybus";
+            VehicleKind kind = vehicleKindFor(type);
+            store.add(id, route, *city, speed, kind, VehicleInfo{intern("Route"), intern(type)});
+
+            LegacyState state;
+            state.vehicle_id = id;
+            state.route_id = city->route(route).route_id;
+            state.stop_ids = city->route(route).stop_indices;
+            state.current_stop_idx = 0;
+            const auto& segment = city->route(route).segments[0];
+            state.x = segment.start_x;
+            state.y = segment.start_y;
+            state.target_x = segment.end_x;
+            state.target_y = segment.end_y;
+            state.speed = speed;
+            state.progress = 0.0;
+            state.forward = true;
+            state.dwell_time = 0.0;
+            state.model = std::make_shared<LegacyModel>(kVehicleKinds[kind].dwell_time);
+            legacy[id] = state;
+        }
+
+        double map_rate = ticksPerSecond([&] {
+            for (auto& [id, state] : legacy) {
+                legacyUpdate(state, *city, kDeltaTime);
+            }
+        });
+        double soa_rate = ticksPerSecond([&] {
+            store.advance(*city, kDeltaTime);
+        });
+
+        std::printf("%10d %16.1f %16.1f %8.2fx\n", count, map_rate, soa_rate, soa_rate / map_rate);
+    }
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <memory>
 #include "database.h"
+#include "scenario.h"
 #include "simulation.h"
 
 // Forward declaration
@@ -21,6 +22,7 @@ public:
 private:
     std::shared_ptr<Database> db_;
     std::shared_ptr<Simulation> sim_;
+    ScenarioRunner scenarios_; // what-if runs, on as many threads as the simulation
     httplib::Server* server_;
 
     // Helper methods for JSON responses
@@ -0,0 +1,82 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "topology.h"
+#include "vehicle_store.h"
+
+// Saved state of one vehicle: enough to resume it mid-segment on its route.
+// Speed and type are not saved, they come from the database on restore.
+struct VehicleCheckpoint {
+    int vehicle_id;
+    int route_id;
+    int stop_idx;
+    bool forward;
+    double travelled; // arc length covered along the current segment
+    double velocity;
+    double dwell;
+    uint64_t rng;
+};
+
+// Versioned binary image of the simulation state.
+//
+// File layout (native byte order): a fixed header with magic, format
+// version, tick, sim time and vehicle count, then one column per field,
+// widest first. A capture is a few memcpy's of the store's columns, and the
+// file is written with a single call.
+struct Checkpoint {
+    uint64_t tick = 0;
+    double sim_time = 0.0;
+    std::vector<VehicleCheckpoint> vehicles;
+
+    // Serializes the stores, one after the other; caller holds whatever
+    // lock guards them
+    static std::vector<char> encode(const std::vector<const VehicleStore*>& stores,
+                                    const Topology& topology, uint64_t tick, double sim_time);
+    static std::vector<char> encode(const VehicleStore& store, const Topology& topology,
+                                    uint64_t tick, double sim_time) {
+        return encode(std::vector<const VehicleStore*>{&store}, topology, tick, sim_time);
+    }
+
+    // False if the file is missing, truncated or from another format version
+    static bool read(const std::string& path, Checkpoint& checkpoint);
+
+    // Writes the image to path + ".tmp" and renames it over path, so a crash
+    // mid-write leaves the previous checkpoint intact
+    static bool write(const std::string& path, const std::vector<char>& image);
+};
+
+// Writes checkpoint images on its own thread, so file I/O never delays a
+// tick. Only the latest image matters: one submitted while another is still
+// pending replaces it.
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::string path);
+    ~CheckpointWriter(); // writes whatever is still pending
+
+    void submit(std::vector<char> image);
+    // Blocks until every submitted image is on disk
+    void flush();
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<char> pending_;
+    bool has_pending_ = false;
+    bool writing_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void run();
+};
+
+#endif // CHECKPOINT_H
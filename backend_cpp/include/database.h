@@ -3,7 +3,12 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <sqlite3.h>
 
 struct Stop {
@@ -28,6 +33,25 @@ struct Vehicle {
     std::string route_name;
 };
 
+// Tunable parameters of a transport type ("bus", "tram", ...)
+struct VehicleType {
+    int id;
+    std::string name;
+    double dwell_mean;   // seconds at a stop
+    double dwell_spread; // dwell is uniform in [mean - spread, mean + spread]
+    double speed_factor; // multiplies the vehicle's avg_speed
+    double acceleration; // m/s^2 from standstill, 0 = reaches cruise speed instantly
+    int capacity;
+};
+
+// Everything the simulation is built from
+struct NetworkData {
+    std::vector<Stop> stops;
+    std::vector<Route> routes;
+    std::vector<Vehicle> vehicles;
+    std::vector<VehicleType> vehicle_types;
+};
+
 struct RouteStop {
     int route_id;
     int stop_id;
@@ -36,37 +60,163 @@ struct RouteStop {
 
 class Database {
 public:
-    Database(const std::string& db_path);
+    // Groups writes into one transaction, synced to disk once: commit()
+    // applies all of them, and none are applied if the Transaction goes out
+    // of scope first. A transaction opened inside another joins it, and the
+    // outer one then rolls back unless every inner one committed. Other
+    // threads' writes wait until it ends; their reads see the state before it.
+    class Transaction {
+    public:
+        explicit Transaction(Database& db);
+        ~Transaction();
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+        // False if BEGIN failed (e.g. the database stayed busy): writes made
+        // now would not be part of a transaction, so callers bail out first
+        bool ok() const { return !done_ && db_.transaction_open_; }
+
+        // False if anything in the transaction failed; it is rolled back then
+        bool commit();
+
+    private:
+        Database& db_;
+        std::unique_lock<std::recursive_mutex> lock_;
+        bool done_ = false;
+
+        bool finish(bool commit);
+    };
+
+    // max_readers: read-only connections in the pool, opened as needed
+    // (0 = one per hardware thread)
+    Database(const std::string& db_path, size_t max_readers = 0);
     ~Database();
 
     bool initialize();
     bool createTables();
     bool insertSampleData();
+    bool insertDefaultVehicleTypes();
 
     // Stops
     std::vector<Stop> getAllStops();
-    bool createOrUpdateStop(const Stop& stop);
+    // saved_id (optional) receives the id of the stored row, new or existing
+    bool createOrUpdateStop(const Stop& stop, int* saved_id = nullptr);
     Stop getStopById(int id);
 
     // Routes
     std::vector<Route> getAllRoutes();
-    bool createOrUpdateRoute(const Route& route);
+    bool createOrUpdateRoute(const Route& route, int* saved_id = nullptr);
     Route getRouteById(int id);
     std::vector<RouteStop> getRouteStops(int route_id);
 
     // Vehicles
     std::vector<Vehicle> getAllVehicles();
-    bool createOrUpdateVehicle(const Vehicle& vehicle);
+    bool createOrUpdateVehicle(const Vehicle& vehicle, int* saved_id = nullptr);
+    bool deleteVehicle(int id);
     Vehicle getVehicleById(int id);
 
+    // Vehicle types
+    std::vector<VehicleType> getAllVehicleTypes();
+    bool createOrUpdateVehicleType(const VehicleType& type);
+
+    NetworkData getNetworkData();
+
 private:
+    // One SQLite connection and the statements prepared on it: each query
+    // shape is compiled once per connection and then only rebound. Used by
+    // one thread at a time.
+    struct Connection {
+        sqlite3* handle = nullptr;
+        std::unordered_map<std::string, sqlite3_stmt*> statements;
+
+        Connection() = default;
+        ~Connection();
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        // Cached statement for sql, ready to bind; nullptr if it does not compile
+        sqlite3_stmt* statement(const std::string& sql);
+    };
+
+    class ReadSnapshot;
+
+    // Connection for one read: the one pinned by the thread's ReadSnapshot,
+    // a pooled read-only connection, or the writer when the calling thread
+    // is inside a transaction (so it reads its own writes) or the pool
+    // cannot open one
+    class ReadLease {
+    public:
+        explicit ReadLease(Database& db);
+        ~ReadLease();
+        Connection& connection() { return *connection_; }
+
+    private:
+        Database& db_;
+        Connection* connection_ = nullptr;
+        bool pinned_ = false; // borrowed from a ReadSnapshot
+        std::unique_lock<std::recursive_mutex> writer_lock_; // held when reading on the writer
+    };
+
+    // Keeps one lease for every read the calling thread makes on this
+    // database until it goes out of scope, inside a single read transaction,
+    // so they all see the same committed state
+    class ReadSnapshot {
+    public:
+        explicit ReadSnapshot(Database& db);
+        ~ReadSnapshot();
+        ReadSnapshot(const ReadSnapshot&) = delete;
+        ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+
+    private:
+        friend class ReadLease;
+
+        Database& db_;
+        ReadLease lease_;
+        ReadSnapshot* outer_;  // the thread's previous snapshot, restored on exit
+        bool began_ = false;   // BEGIN ran here, so COMMIT does too
+    };
+    static thread_local ReadSnapshot* thread_snapshot_;
+
     std::string db_path_;
-    sqlite3* db_;
+
+    // The only connection that writes; guarded by write_mutex_, which a
+    // Transaction holds for its whole duration
+    Connection writer_;
+    std::recursive_mutex write_mutex_;
+    // Transaction nesting, guarded by write_mutex_
+    int transaction_depth_ = 0;
+    bool transaction_open_ = false;   // BEGIN succeeded
+    bool transaction_failed_ = false; // an inner transaction was not committed
+    std::atomic<std::thread::id> transaction_thread_{}; // owner of the open transaction
+
+    // Read-only connections. With WAL journaling readers neither wait for
+    // the writer nor for each other.
+    size_t max_readers_;
+    std::vector<std::unique_ptr<Connection>> readers_; // every one opened
+    std::vector<Connection*> idle_readers_;
+    std::mutex readers_mutex_;
+    std::condition_variable reader_returned_;
+
+    bool openReader(Connection& reader);
+
+    // Runs a cached statement on the writer with parameters bound in order,
+    // to completion
+    template <typename... Args>
+    bool execute(const std::string& sql, const Args&... args);
+    // Runs a cached query on a leased connection and calls fn with a reader
+    // for each row
+    template <typename Fn, typename... Args>
+    bool forEachRow(const std::string& sql, Fn fn, const Args&... args);
+    // Runs a cached query and decodes every row into a T, column by column
+    // in its stored type. size_hint rows are reserved up front.
+    template <typename T, typename... Args>
+    std::vector<T> queryRows(const std::string& sql, size_t size_hint, const Args&... args);
+    // Decodes the first row into result; false if there is none
+    template <typename T, typename... Args>
+    bool queryRow(const std::string& sql, T& result, const Args&... args);
+    size_t countRows(const std::string& table);
 
     bool executeQuery(const std::string& query);
-    bool executeQueryWithCallback(const std::string& query, 
-                                   int (*callback)(void*, int, char**, char**), 
-                                   void* data);
 };
 
 #endif // DATABASE_H
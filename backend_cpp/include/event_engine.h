@@ -0,0 +1,83 @@
+#ifndef EVENT_ENGINE_H
+#define EVENT_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "topology.h"
+#include "vehicle_store.h"
+
+// How the simulation advances vehicle state
+enum class SimulationEngine {
+    FixedTick,  // integrate every vehicle every tick
+    EventDriven // jump between stop arrival/departure events
+};
+
+const char* simulationEngineName(SimulationEngine engine);
+
+// Discrete-event core. Between stops a vehicle moves in a straight line,
+// accelerating to a constant cruise speed, so its position is a closed-form
+// function of the time it left the last stop. Only arrivals and departures are simulated; positions
+// are computed on demand by materialize().
+//
+// The engine works on slots of a VehicleStore and has to follow every
+// change made to the store outside of it: refresh() a slot after editing or
+// appending it, removeSlot() when the store swap-removes one, or reset()
+// after anything larger. Other slots keep their exact schedule.
+class EventEngine {
+public:
+    // Rebuilds the event queue from the store's current state at time `now`
+    void reset(const VehicleStore& store, double now);
+
+    // Reschedules slot i (appended to the store if it is new) from the
+    // store's state at time `now`; the event it had pending is dropped
+    void refresh(const VehicleStore& store, size_t i, double now);
+
+    // Mirrors VehicleStore::remove: the last slot's schedule moves into slot i
+    void removeSlot(size_t i);
+
+    // Processes all events with time <= until, in time order
+    void advanceTo(VehicleStore& store, const Topology& topology, double until);
+
+    // Writes the analytic state at time t into x/y/travelled/progress/dwell of
+    // slots [begin, end), so the store can be published or handed back to the
+    // fixed-tick engine. Slots are independent; safe to call in parallel.
+    void materialize(VehicleStore& store, double t, size_t begin, size_t end) const;
+
+    // Includes dropped events that have not reached the top of the queue yet
+    size_t pendingEvents() const { return queue_.size(); }
+    uint64_t processedEvents() const { return processed_; }
+
+private:
+    enum class EventType : uint8_t { Arrival, Departure };
+
+    // The kind of event is kept per slot: only the slot's latest event is live
+    struct Event {
+        double time;
+        uint32_t slot;
+        uint32_t generation; // stale unless equal to generation_[slot]
+
+        // Min-heap on time; slot breaks ties so the order is deterministic
+        bool operator>(const Event& other) const {
+            if (time != other.time) return time > other.time;
+            return slot > other.slot;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue_;
+    // Per slot
+    std::vector<double> depart_time_; // when the current segment was (or will be) started
+    std::vector<double> next_time_;   // time of the live event, infinity if parked
+    std::vector<EventType> next_type_;
+    // Per slot, never shrunk, so a slot index that is reused after a removal
+    // does not revive the events of the vehicle that had it before
+    std::vector<uint32_t> generation_;
+    uint64_t processed_ = 0;
+
+    void start(const VehicleStore& store, size_t i, double now); // schedules slot i from scratch
+    void schedule(size_t i, double time, EventType type);
+    void scheduleArrival(const VehicleStore& store, size_t i);
+};
+
+#endif // EVENT_ENGINE_H
@@ -0,0 +1,84 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <variant>
+#include <vector>
+#include "database.h"
+#include "event_engine.h"
+#include "tick_scheduler.h"
+
+// Incremental change to the running simulation, queued by the admin API
+struct RemoveVehicle {
+    int vehicle_id;
+};
+// The whole vehicle_types table after an edit, in database order
+struct SetVehicleTypes {
+    std::vector<VehicleType> types;
+};
+using DataCommand = std::variant<Stop, Route, Vehicle, RemoveVehicle, SetVehicleTypes>;
+
+// Inputs that can reach a running simulation. Only data batches and engine
+// switches change what a tick computes; pause, speed and catch-up only
+// change how ticks map to wall time, and are recorded for reference.
+struct DataBatch {
+    std::vector<DataCommand> commands; // applied together, in order
+};
+struct SetEngine {
+    SimulationEngine engine;
+};
+struct SetPaused {
+    bool paused;
+};
+struct SetTimeScale {
+    double time_scale;
+};
+struct SetCatchUp {
+    CatchUpPolicy policy;
+    unsigned max_catch_up;
+};
+// Hash of the vehicle state after the tick, checked on replay
+struct StateDigest {
+    uint64_t digest;
+};
+using JournalInput = std::variant<DataBatch, SetEngine, SetPaused, SetTimeScale, SetCatchUp, StateDigest>;
+
+struct JournalEntry {
+    uint64_t tick; // ticks completed when the input was applied
+    JournalInput input;
+};
+
+// Record of one simulation run: what it started from, then every input in
+// the order it was applied, stamped with its tick. Stored as JSON Lines:
+// a header line with the seed, engine and network data, then one line per
+// entry. Replaying it from the same inputs reproduces the run bit for bit,
+// whatever the number of worker threads.
+struct Journal {
+    uint64_t seed = 0;
+    SimulationEngine engine = SimulationEngine::FixedTick;
+    NetworkData data;
+    std::vector<JournalEntry> entries;
+
+    // False if the file is missing or malformed
+    static bool read(const std::string& path, Journal& journal);
+};
+
+// Appends to a journal file as inputs are applied. Not thread-safe: the
+// simulation calls it under its state lock.
+class JournalWriter {
+public:
+    JournalWriter(const std::string& path, const NetworkData& data, uint64_t seed,
+                  SimulationEngine engine);
+
+    bool isOpen() const { return out_.is_open(); }
+    void record(uint64_t tick, const JournalInput& input);
+    uint64_t lastDigestTick() const { return last_digest_tick_; }
+
+private:
+    std::ofstream out_;
+    uint64_t last_digest_tick_ = 0;
+};
+
+#endif // JOURNAL_H
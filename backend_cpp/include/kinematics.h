@@ -0,0 +1,64 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// km/h -> m/s -> units/s (1 unit = 100m)
+const double kKmhPerUnitPerSecond = 0.36;
+
+inline double unitsPerSecond(double speed_kmh) {
+    return speed_kmh / kKmhPerUnitPerSecond;
+}
+
+// Closed-form motion along a segment, starting from standstill and
+// accelerating at `accel` (km/h per second) up to `cruise` (km/h). With
+// accel = 0 the vehicle moves at cruise speed from the start.
+double distanceAfter(double elapsed, double cruise, double accel); // units
+double velocityAfter(double elapsed, double cruise, double accel); // km/h
+// Inverse of distanceAfter; infinite if the segment is never completed
+double timeToCover(double distance, double cruise, double accel);
+
+// Instruction set used by the vehicle motion kernel
+enum class SimdLevel {
+    Scalar,
+    SSE2, // 2 vehicles per instruction
+    AVX2  // 4 vehicles per instruction
+};
+
+// Best level supported by the CPU we are running on
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Column pointers of the VehicleStore that the motion kernel touches
+struct MotionColumns {
+    double* x;
+    double* y;
+    const double* start_x; // current segment
+    const double* start_y;
+    const double* dir_x;
+    const double* dir_y;
+    const double* length;
+    const double* inv_length;
+    double* travelled;
+    const double* speed;   // cruise speed, km/h
+    double* velocity;      // current speed, km/h
+    const double* accel;   // km/h per second
+    double* progress;
+    double* dwell;
+};
+
+// Advances dwelling and moving vehicles in [begin, end) by delta_time.
+// Moving vehicles first gain accel * delta_time of velocity, capped at their
+// cruise speed, then cover velocity * delta_time.
+// Vehicles that reach the end of their segment this step are left untouched
+// and their slots are written to `arrivals` (capacity end - begin) for the
+// caller to handle.
+// Returns the number of arrivals. All variants produce bit-identical results.
+using MotionKernel = size_t (*)(const MotionColumns& columns, size_t begin, size_t end,
+                                double delta_time, uint32_t* arrivals);
+
+// Falls back to the best supported level if `level` is not available
+MotionKernel motionKernel(SimdLevel level);
+
+#endif // KINEMATICS_H
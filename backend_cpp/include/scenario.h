@@ -0,0 +1,67 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "database.h"
+#include "service_metrics.h"
+#include "simulation.h"
+#include "worker_pool.h"
+
+// Extra vehicles of one type on a route, starting at its first stop
+struct AddVehicles {
+    int route_id;
+    int count;
+    std::string type;
+    double avg_speed; // km/h
+};
+
+// A what-if variation of the live state
+struct ScenarioSpec {
+    std::string name;
+    std::vector<AddVehicles> add_vehicles;
+    // vehicle type -> multiplier on the average speed of its vehicles
+    std::unordered_map<std::string, double> speed_factors;
+    std::vector<int> remove_vehicles; // vehicle ids
+};
+
+struct ScenarioResult {
+    std::string name;
+    size_t vehicles;
+    RouteService total;
+    std::vector<RouteService> routes;
+    double wall_seconds;
+};
+
+struct ScenarioReport {
+    uint64_t tick;       // live tick the scenarios were forked at
+    double sim_time;
+    double sim_seconds;  // simulated per scenario
+    double wall_seconds;
+    std::vector<ScenarioResult> results; // the unchanged baseline first, then the scenarios in order
+};
+
+// Runs what-if scenarios side by side. Each batch forks the live simulation
+// once, so every scenario starts from the same tick, then forks that copy
+// per scenario and runs the forks unpaced, one per pool task.
+class ScenarioRunner {
+public:
+    explicit ScenarioRunner(size_t threads);
+
+    size_t threads() const { return pool_.size(); }
+
+    // `data` is the network the live simulation was built from: scenario
+    // edits are turned into vehicle upserts against it. Blocks until every
+    // scenario has run sim_seconds; one batch at a time.
+    ScenarioReport run(Simulation& live, const NetworkData& data, const std::vector<ScenarioSpec>& scenarios,
+                       double sim_seconds);
+
+private:
+    WorkerPool pool_;
+    std::mutex run_mutex_;
+};
+
+#endif // SCENARIO_H
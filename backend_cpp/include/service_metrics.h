@@ -0,0 +1,53 @@
+#ifndef SERVICE_METRICS_H
+#define SERVICE_METRICS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "topology.h"
+#include "vehicle_store.h"
+
+// Service quality of one route over a run
+struct RouteService {
+    int route_id;
+    std::string route_name;
+    uint64_t arrivals = 0;        // stop arrivals observed
+    uint64_t headways = 0;        // arrivals that followed an earlier one at the same stop
+    double average_headway = 0.0; // seconds between consecutive vehicles at a stop
+    // Seconds a passenger turning up at a random time waits on average,
+    // E[h^2] / 2E[h]: irregular headways make it longer than half the headway
+    double average_wait = 0.0;
+};
+
+// Records headways from stop arrivals. A vehicle has arrived when its stop
+// index changed since the previous tick; the headway at a stop is the time
+// since the previous vehicle of the same route, in the same direction,
+// arrived there.
+class ServiceMetrics {
+public:
+    // Call after every tick with each group of slots (one per shard) in turn
+    void observe(size_t group, const VehicleStore& store, const Topology& topology, double now);
+    // The fleet layout changed: slots no longer refer to the same vehicles
+    void forgetSlots() { last_stop_.clear(); }
+
+    // One entry per route with at least one arrival, in route order
+    std::vector<RouteService> routes(const Topology& topology) const;
+    // All routes together
+    RouteService total() const;
+
+private:
+    struct RouteState {
+        std::vector<double> last_arrival; // [stop * 2 + forward], < 0 before the first
+        uint64_t arrivals = 0;
+        uint64_t headways = 0;
+        double headway_sum = 0.0;
+        double headway_squares = 0.0;
+    };
+
+    std::vector<std::vector<int>> last_stop_; // per group and slot
+    std::vector<RouteState> routes_;          // by route index
+
+    static void summarize(const RouteState& state, RouteService& service);
+};
+
+#endif // SERVICE_METRICS_H
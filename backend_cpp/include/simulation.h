@@ -2,14 +2,23 @@
 #define SIMULATION_H
 
 #include <vector>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <unordered_map>
+#include "checkpoint.h"
 #include "database.h"
-#include "transport_models.h" 
+#include "event_engine.h"
+#include "journal.h"
+#include "service_metrics.h"
+#include "topology.h"
+#include "vehicle_store.h"
+#include "snapshot_publisher.h"
+#include "spatial_grid.h"
+#include "tick_scheduler.h"
+#include "worker_pool.h"
 
 struct VehiclePosition {
     int vehicle_id;
@@ -17,57 +26,239 @@ struct VehiclePosition {
     double y;
     int current_stop_index;
     int next_stop_index;
-    std::string route_name;
-    std::string type;
+    Symbol route_name; // resolve with symbolName()
+    Symbol type;
     double progress; // 0.0 to 1.0 along current segment
 };
 
+// Vehicles whose published position changed between two snapshots
+struct ChangeSet {
+    uint64_t from_version; // version of the previous snapshot
+    uint64_t to_version;
+    std::vector<uint32_t> slots; // indices into LiveSnapshot::positions
+};
+
+// Immutable view of all live positions after one tick
+struct LiveSnapshot {
+    uint64_t tick; // increases by one per simulated tick
+    // Increases by one per published snapshot, also when admin changes are
+    // published without the tick advancing (paused, restored, slow time scale)
+    uint64_t version;
+    double sim_time; // seconds since the simulation was created
+    std::vector<VehiclePosition> positions;
+    // vehicle_id -> index in positions, shared between snapshots of the same fleet
+    std::shared_ptr<const std::unordered_map<int, size_t>> index;
+    // Change sets of the most recent snapshots, oldest first and contiguous.
+    // Restarted whenever the fleet layout (index) changes.
+    std::vector<std::shared_ptr<const ChangeSet>> history;
+    // Slots by location, for viewport queries
+    std::shared_ptr<const SpatialGrid> grid;
+
+    const VehiclePosition* find(int vehicle_id) const;
+    // Positions inside the box (edges included), at a cost proportional to
+    // the vehicles in and around it
+    std::vector<VehiclePosition> inBox(const Bounds& box) const;
+
+    // Collects the slots that changed after version `since` into `slots`
+    // (sorted, unique). Returns false if `since` is older than the history
+    // or from another fleet layout; the reader must then resync from positions.
+    bool changedSince(uint64_t since, std::vector<uint32_t>& slots) const;
+};
+
+// Route-affine slice of the fleet with its own state arrays and event
+// queue. Vehicles never interact, so shards advance independently of each
+// other; the simulation steps them in lock-step, one worker task per shard.
+struct alignas(64) SimulationShard {
+    VehicleStore vehicles;
+    EventEngine events;
+    size_t offset = 0; // slot of its first vehicle in LiveSnapshot::positions
+};
+
+// Outcome of a headless run
+struct RunStats {
+    uint64_t ticks;
+    double sim_seconds;
+    double wall_seconds;
+
+    double simSecondsPerWallSecond() const {
+        return wall_seconds > 0.0 ? sim_seconds / wall_seconds : 0.0;
+    }
+};
+
+// Outcome of replaying a journal
+struct ReplayStats {
+    uint64_t ticks;
+    uint64_t inputs;          // entries other than digests
+    uint64_t digests;         // state digests compared
+    uint64_t mismatches;      // digests that differ from the recorded run
+    uint64_t first_mismatch;  // tick of the first one
+    double wall_seconds;
+};
+
 class Simulation {
 public:
-    Simulation(std::shared_ptr<Database> db);
+    // worker_threads: size of the pool that runs the vehicle update phase,
+    // and the number of shards the fleet is split into.
+    // seed: per-vehicle random streams (dwell times); same seed and inputs,
+    // same run.
+    Simulation(std::shared_ptr<Database> db, size_t worker_threads = 1, uint64_t seed = 0);
+    // Built from recorded data instead of the database, for replay
+    Simulation(const NetworkData& data, size_t worker_threads, uint64_t seed);
     ~Simulation();
 
     void start();
     void stop();
     bool isRunning() const;
-    void pause() { paused_ = true; }
-    void resume() { paused_ = false; }
+    void pause();
+    void resume();
     bool isPaused() const { return paused_; }
+    size_t workerThreads() const { return workers_.size(); }
+    uint64_t seed() const { return seed_; }
+    // Vehicles per shard
+    std::vector<size_t> shardSizes();
 
+    // Switches between the fixed-tick and the event-driven core; vehicle
+    // state carries over
+    void setEngine(SimulationEngine engine);
+    SimulationEngine engine() const { return engine_; }
+
+    // Speed of the live loop in sim seconds per wall second (1 = real time)
+    void setTimeScale(double scale);
+    double timeScale() const { return time_scale_; }
+
+    // Headless mode: runs the model for sim_seconds on the calling thread,
+    // as fast as the CPU allows (time_scale <= 0) or at time_scale x real
+    // time. The live loop stands by meanwhile, then carries on paused or
+    // not as pause()/resume() last left it; snapshots keep being published
+    // about every 100ms of wall time.
+    RunStats runFor(double sim_seconds, double time_scale = 0.0);
+
+    // What the live loop does with wall time lost to overrunning ticks:
+    // drop it (default) or simulate up to max_catch_up extra periods
+    void setCatchUp(CatchUpPolicy policy, unsigned max_catch_up);
+    CatchUpPolicy catchUpPolicy() const { return scheduler_.policy(); }
+    unsigned maxCatchUp() const { return scheduler_.maxCatchUp(); }
+    // Live loop timing: overruns, dropped time, tick duration histogram
+    TickMetrics tickMetrics() const { return scheduler_.metrics(); }
+
+    // Hot reload: queues a change that the simulation thread applies before
+    // its next tick. Stop and route edits swap in new geometry copy-on-write;
+    // vehicles are added, updated, moved to another route or removed one by
+    // one, and every other vehicle keeps its state.
+    void upsertStop(const Stop& stop);
+    void upsertRoute(const Route& route);
+    // Throws std::length_error if the vehicle's names cannot be interned.
+    // Symbols are never freed, so callers pass names from closed sets.
+    void upsertVehicle(const Vehicle& vehicle);
+    void removeVehicle(int vehicle_id);
+    // Swaps in a type table rebuilt from every row of vehicle_types.
+    // Vehicles look their type up by name again, as after a restart; those
+    // whose speed factor or acceleration changed carry on from where they
+    // are with the new values, and new dwell times apply from the next stop.
+    void reloadVehicleTypes(const std::vector<VehicleType>& types);
+
+    // Persistence. restoreCheckpoint() resumes the fleet from a file written
+    // by an earlier run; vehicles that are gone or were moved to another
+    // route since stay at their first stop. Returns false if there is no
+    // usable checkpoint.
+    bool restoreCheckpoint(const std::string& path);
+    // Call before start(): the live loop then writes a checkpoint every
+    // `interval` of wall time, and stop() writes a final one
+    void enableCheckpoints(const std::string& path, std::chrono::seconds interval);
+    // Captures the state now and queues it for the writer thread;
+    // false if checkpoints are not enabled
+    bool checkpoint();
+
+    // Record and replay. enableJournal() must be called before the simulation
+    // has run: it records the network data, seed and engine, then every
+    // input as it is applied, with a state digest every simulated minute
+    // and on stop(). Returns false if the file cannot be written.
+    bool enableJournal(const std::string& path);
+    // Headless: runs a simulation constructed from journal.data and
+    // journal.seed through the recorded inputs, on the calling thread, and
+    // checks every digest
+    ReplayStats replay(const Journal& journal);
+
+    // What-if analysis. fork() copies the current state into a new, paused
+    // simulation that runs on the calling thread: topology and vehicle types
+    // are shared, only the vehicle arrays are copied. The copy has no
+    // database, checkpoints or journal; its seed and engine carry over.
+    std::unique_ptr<Simulation> fork();
+    // Starts recording headways at every stop from the next tick on
+    void trackService();
+    // Routes with recorded arrivals, and all routes together
+    std::vector<RouteService> serviceByRoute();
+    RouteService serviceTotal();
+
+    // Latest published snapshot; lock-free and zero-copy, safe from any thread
+    std::shared_ptr<const LiveSnapshot> getLiveSnapshot() const { return snapshots_.load(); }
     std::vector<VehiclePosition> getLivePositions();
+    std::vector<VehiclePosition> getLivePositionsInBox(double min_x, double min_y, double max_x, double max_y);
     VehiclePosition getVehiclePosition(int vehicle_id);
 
 private:
     std::shared_ptr<Database> db_;
+    std::shared_ptr<const Topology> topology_;
     std::atomic<bool> running_;
     std::atomic<bool> paused_;
+    std::atomic<bool> headless_{false}; // runFor() in progress: the live loop stands by
     std::thread simulation_thread_;
-    std::mutex positions_mutex_;
-
-    struct VehicleState {
-        int vehicle_id;
-        int route_id;
-        std::vector<int> stop_ids;
-        int current_stop_idx;
-        double x;
-        double y;
-        double target_x;
-        double target_y;
-        double speed; // km/h
-        double progress; // 0.0 to 1.0
-        bool forward; // direction
-        double dwell_time; // seconds remaining at stop
-
-        std::shared_ptr<ITransportModel> model; // Поліморфний об'єкт (Композиція)  
-    };
-
-    std::map<int, VehicleState> vehicle_states_;
-    std::map<int, VehiclePosition> live_positions_;
+    std::mutex state_mutex_; // guards the vehicle state; readers use snapshots_
+    WorkerPool workers_;
+    std::atomic<SimulationEngine> engine_;
+    std::atomic<double> time_scale_;
+    std::mutex run_mutex_; // one headless run at a time
+    TickScheduler scheduler_; // live loop pacing, driven by simulation_thread_
+
+    std::vector<SimulationShard> shards_;
+    // route index -> shards holding its vehicles; a route with more than a
+    // fair share of the fleet is spread over several
+    std::vector<std::vector<int>> route_shards_;
+    std::shared_ptr<const VehicleTypes> vehicle_types_;
+    uint64_t seed_;
+    uint64_t tick_ = 0;
+    double sim_time_ = 0.0; // seconds
+
+    std::mutex commands_mutex_;
+    std::vector<DataCommand> pending_commands_;
+
+    // Encoded between ticks on the simulation thread, written on the writer's own thread
+    std::unique_ptr<CheckpointWriter> checkpoints_;
+    std::chrono::seconds checkpoint_interval_{0};
+    std::unique_ptr<JournalWriter> journal_; // written under state_mutex_
+    std::unique_ptr<ServiceMetrics> service_; // updated under state_mutex_
+
+    SnapshotPublisher<LiveSnapshot> snapshots_;
+    std::shared_ptr<const std::unordered_map<int, size_t>> snapshot_index_;
+    std::vector<std::vector<uint32_t>> shard_changes_; // publishSnapshot() scratch, per shard
 
     void simulationLoop();
-    void updateVehicle(VehicleState& state, double delta_time);
-    void initializeVehicles();
-    std::pair<double, double> getStopCoordinates(int stop_id);
+    void initializeVehicles(const NetworkData& data);
+    void switchEngine(SimulationEngine engine); // caller holds state_mutex_
+    uint64_t stateDigest(); // caller holds state_mutex_
+    void record(const JournalInput& input); // caller holds state_mutex_
+    void step(double delta_time); // caller holds state_mutex_
+    void publishSnapshot();
+    void submitCheckpoint(); // caller holds state_mutex_
+    void rebuildSnapshotIndex();
+    // Redistributes all vehicles over the shards by vehicle count (LPT)
+    void rebalanceShards();
+    bool shardsUnbalanced() const;
+    int shardFor(int route); // shard for a vehicle newly placed on the route
+    bool locate(int vehicle_id, int& shard, int& slot) const;
+    template <typename Fn> void forEachShard(Fn fn); // in parallel, one task per shard
+    void enqueue(DataCommand command);
+    // Caller holds state_mutex_. Returns true if anything was applied.
+    bool applyPendingCommands();
+    bool applyVehicle(const Vehicle& vehicle); // true if the fleet layout changed
+    void applyVehicleTypes(std::shared_ptr<const VehicleTypes> types);
+    // Event mode keeps positions analytic: syncSlot() writes a slot's out
+    // before it is edited, rescheduleSlot() replans it afterwards. Other
+    // vehicles keep their exact schedule. Both do nothing in fixed-tick mode.
+    void syncSlot(SimulationShard& shard, size_t slot);
+    void rescheduleSlot(SimulationShard& shard, size_t slot);
+    // Removes the vehicle from the shard's store and its event queue
+    bool removeFromShard(SimulationShard& shard, int vehicle_id);
 };
 
 #endif // SIMULATION_H
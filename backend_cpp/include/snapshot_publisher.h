@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_PUBLISHER_H
+#define SNAPSHOT_PUBLISHER_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Single-writer publication of immutable snapshots to many readers.
+//
+// The writer stores each new snapshot in a slot that is neither current nor
+// being read, then flips `current_`. Readers announce themselves on the slot
+// they are about to read and re-check that it is still current before taking
+// a reference, so they never block on the writer or on each other and never
+// see a slot that is being overwritten. What readers get is a shared handle
+// to the snapshot itself: no copy, and it stays valid as long as it is held.
+template <typename T>
+class SnapshotPublisher {
+public:
+    using Handle = std::shared_ptr<const T>;
+
+    SnapshotPublisher() = default;
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Any thread, lock-free
+    Handle load() const {
+        while (true) {
+            unsigned index = current_.load();
+            Slot& slot = slots_[index];
+            slot.readers.fetch_add(1);
+            if (current_.load() == index) {
+                Handle handle = slot.value;
+                slot.readers.fetch_sub(1);
+                return handle;
+            }
+            slot.readers.fetch_sub(1); // writer moved on, retry on the new slot
+        }
+    }
+
+    // Publisher thread only
+    void publish(Handle value) {
+        unsigned current = current_.load();
+        for (unsigned attempt = 1;; ++attempt) {
+            unsigned index = (current + attempt) % kSlots;
+            if (index == current) {
+                std::this_thread::yield(); // every other slot is being read
+                continue;
+            }
+            if (slots_[index].readers.load() == 0) {
+                slots_[index].value = std::move(value);
+                current_.store(index);
+                return;
+            }
+        }
+    }
+
+private:
+    static constexpr unsigned kSlots = 4;
+
+    struct alignas(64) Slot {
+        std::atomic<unsigned> readers{0};
+        Handle value;
+    };
+
+    mutable Slot slots_[kSlots];
+    std::atomic<unsigned> current_{0};
+};
+
+#endif // SNAPSHOT_PUBLISHER_H
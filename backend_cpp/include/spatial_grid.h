@@ -0,0 +1,52 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "topology.h"
+
+struct VehiclePosition;
+
+// Uniform grid over the network's bounding box, mapping cells to the slots
+// of the vehicles inside them. Immutable like the snapshot that owns it:
+// update() returns a new grid that shares every cell nobody entered or left
+// with its predecessor. It copies only the cells moved vehicles touched,
+// plus the table of cell pointers (at most 64 x 64).
+class SpatialGrid {
+public:
+    static std::shared_ptr<const SpatialGrid> build(const Bounds& bounds,
+                                                    const std::vector<VehiclePosition>& positions);
+
+    // `changed` lists the slots whose position differs between before and after
+    std::shared_ptr<const SpatialGrid> update(const std::vector<VehiclePosition>& before,
+                                              const std::vector<VehiclePosition>& after,
+                                              const std::vector<uint32_t>& changed) const;
+
+    // Appends the slots of positions inside the box (edges included); visits
+    // only the cells that overlap it
+    void query(const Bounds& box, const std::vector<VehiclePosition>& positions,
+               std::vector<uint32_t>& slots) const;
+
+    const Bounds& bounds() const { return bounds_; }
+    size_t columns() const { return columns_; }
+    size_t rows() const { return rows_; }
+
+private:
+    using Cell = std::vector<uint32_t>;
+
+    SpatialGrid() = default;
+
+    Bounds bounds_;
+    double inv_cell_size_ = 0.0;
+    size_t columns_ = 1;
+    size_t rows_ = 1;
+    std::vector<std::shared_ptr<const Cell>> cells_; // null = empty
+
+    size_t column(double x) const;
+    size_t row(double y) const;
+    size_t cellOf(const VehiclePosition& pos) const;
+};
+
+#endif // SPATIAL_GRID_H
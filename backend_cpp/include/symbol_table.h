@@ -0,0 +1,57 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Interned string id. 0 is the empty string.
+using Symbol = uint32_t;
+
+// Process-wide, append-only table of interned strings.
+// intern() takes a lock and is meant for load time (vehicles, routes, types);
+// name() is lock-free and the returned view stays valid for the lifetime of
+// the process, so hot paths carry 4-byte symbols and resolve them only when
+// serializing.
+class SymbolTable {
+public:
+    static SymbolTable& instance();
+
+    Symbol intern(std::string_view text);
+    std::string_view name(Symbol symbol) const;
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kChunkBits = 10;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    static constexpr size_t kMaxChunks = 4096; // ~4M symbols
+
+    // Strings live in fixed-size chunks that are never moved or freed, so
+    // readers can index them without synchronizing with intern()
+    struct Chunk {
+        std::array<std::string, kChunkSize> strings;
+    };
+
+    SymbolTable();
+
+    std::array<std::atomic<Chunk*>, kMaxChunks> chunks_{};
+    std::atomic<size_t> size_{0};
+    std::mutex mutex_; // serializes intern()
+    std::unordered_map<std::string_view, Symbol> lookup_;
+    std::unique_ptr<Chunk> owned_[kMaxChunks];
+};
+
+inline Symbol intern(std::string_view text) {
+    return SymbolTable::instance().intern(text);
+}
+
+inline std::string_view symbolName(Symbol symbol) {
+    return SymbolTable::instance().name(symbol);
+}
+
+#endif // SYMBOL_TABLE_H
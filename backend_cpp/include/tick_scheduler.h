@@ -0,0 +1,73 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// What to do with simulated time when a tick overruns its deadline
+enum class CatchUpPolicy {
+    Skip,   // drop the missed periods (counted in skipped_periods)
+    CatchUp // simulate the missed periods as extra sub-steps, up to a limit
+};
+
+// Upper bounds (ms) of the tick duration histogram buckets; the last bucket
+// is open-ended
+constexpr std::array<double, 10> kTickHistogramBoundsMs = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000};
+
+struct TickMetrics {
+    uint64_t ticks;           // ticks executed
+    uint64_t overruns;        // ticks whose work took longer than one period
+    uint64_t late_wakeups;    // deadlines already passed when a tick finished
+    uint64_t skipped_periods; // periods of sim time dropped under Skip (or beyond the catch-up limit)
+    uint64_t caught_up_periods; // periods simulated as extra sub-steps under CatchUp
+    double max_tick_ms;
+    double mean_tick_ms;
+    std::array<uint64_t, kTickHistogramBoundsMs.size() + 1> histogram;
+};
+
+// Fixed-rate scheduler on absolute deadlines (start + k * period), so sleep
+// and measurement errors never accumulate into drift. Driven by one thread;
+// metrics() may be read from any thread.
+class TickScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TickScheduler(clock::duration period);
+
+    void setPolicy(CatchUpPolicy policy, unsigned max_catch_up);
+    CatchUpPolicy policy() const { return policy_; }
+    unsigned maxCatchUp() const { return max_catch_up_; }
+
+    // Restarts the schedule from now, e.g. after a pause
+    void reset();
+
+    // Call when a tick's work is done. Records its duration, sleeps until the
+    // next deadline and returns how many periods of simulated time the next
+    // tick has to cover (1 unless catching up after an overrun).
+    unsigned waitNext();
+
+    TickMetrics metrics() const;
+
+private:
+    const clock::duration period_;
+    std::atomic<CatchUpPolicy> policy_;
+    std::atomic<unsigned> max_catch_up_;
+
+    clock::time_point next_deadline_;
+    clock::time_point tick_start_;
+
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> late_wakeups_{0};
+    std::atomic<uint64_t> skipped_periods_{0};
+    std::atomic<uint64_t> caught_up_periods_{0};
+    std::atomic<uint64_t> total_tick_us_{0};
+    std::atomic<uint64_t> max_tick_us_{0};
+    std::array<std::atomic<uint64_t>, kTickHistogramBoundsMs.size() + 1> histogram_{};
+
+    void record(clock::duration work);
+};
+
+#endif // TICK_SCHEDULER_H
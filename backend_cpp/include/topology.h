@@ -0,0 +1,88 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "database.h"
+
+struct StopPoint {
+    int stop_id;
+    double x;
+    double y;
+};
+
+// Straight line between two consecutive stops of a route, precomputed so
+// movement is a scalar arc-length parameter along it
+struct Segment {
+    double start_x;
+    double start_y;
+    double end_x;
+    double end_y;
+    double length;
+    double inv_length; // 0 for zero-length segments
+    double dir_x;      // unit direction, 0 for zero-length segments
+    double dir_y;
+};
+
+// Axis-aligned rectangle
+struct Bounds {
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+};
+
+struct RouteGeometry {
+    int route_id;
+    std::string name;
+    std::string type;
+    std::vector<int> stop_indices; // indices into Topology::stops(), in route order
+    std::vector<Segment> segments; // segments[i]: stop i -> stop (i + 1) % size
+};
+
+// Immutable snapshot of the stop/route network.
+// Built once from the database; the simulation tick reads only from here.
+class Topology {
+public:
+    static std::shared_ptr<const Topology> load(Database& db);
+    static std::shared_ptr<const Topology> build(const std::vector<Stop>& stops,
+                                                 const std::vector<Route>& routes);
+
+    // Copy-on-write edits: return a new topology that shares the geometry of
+    // every route the edit does not affect. Existing stops and routes keep
+    // their indices; new ones are appended.
+    std::shared_ptr<const Topology> withStop(const Stop& stop) const;
+    std::shared_ptr<const Topology> withRoute(const Route& route) const;
+
+    const std::vector<StopPoint>& stops() const { return stops_; }
+    size_t routeCount() const { return routes_.size(); }
+
+    // Bounding box of all stops (and so of every route); all zero when empty
+    const Bounds& bounds() const { return bounds_; }
+
+    const StopPoint& stop(int index) const { return stops_[index]; }
+    const RouteGeometry& route(int index) const { return *routes_[index]; }
+    // Same object in two topologies means unchanged geometry
+    const std::shared_ptr<const RouteGeometry>& sharedRoute(int index) const { return routes_[index]; }
+
+    // Returns -1 for unknown ids
+    int stopIndex(int stop_id) const;
+    int routeIndex(int route_id) const;
+
+private:
+    Topology() = default;
+
+    std::vector<StopPoint> stops_;
+    std::vector<std::shared_ptr<const RouteGeometry>> routes_;
+    Bounds bounds_{0.0, 0.0, 0.0, 0.0};
+    std::unordered_map<int, int> stop_index_;
+    std::unordered_map<int, int> route_index_;
+
+    std::shared_ptr<const RouteGeometry> makeRoute(const Route& route) const;
+    void computeSegments(RouteGeometry& geometry) const;
+    void computeBounds();
+};
+
+#endif // TOPOLOGY_H
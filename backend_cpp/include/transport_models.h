@@ -2,59 +2,94 @@
 #ifndef TRANSPORT_MODELS_H
 #define TRANSPORT_MODELS_H
 
-#include <string>
-
-// 1. АБСТРАКЦІЯ (Abstract Base Class)
-// Визначає контракт для всіх типів транспорту
-class ITransportModel {
-public:
-    virtual ~ITransportModel() = default; // Віртуальний деструктор
-
-    // Чисто віртуальні методи (must be implemented)
-    virtual double getDwellTime() const = 0;      // Час очікування на зупинці
-    virtual double getSpeedFactor() const = 0;    // Коефіцієнт швидкості
-    virtual std::string getIcon() const = 0;      // Іконка для логів/дебагу
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// 1. АБСТРАКЦІЯ (статичний поліморфізм, CRTP)
+// Визначає контракт для всіх типів транспорту. Параметри - константи часу
+// компіляції, тому жодних віртуальних викликів і об'єктів на кожен ТЗ
+template <typename Derived>
+struct TransportModel {
+    static constexpr std::string_view name() { return Derived::kName; }   // Назва типу в БД/API
+    static constexpr double dwellTime() { return Derived::kDwellTime; }     // Час очікування на зупинці
+    static constexpr double dwellSpread() { return Derived::kDwellSpread; } // Розкид часу очікування (+/-)
+    static constexpr double speedFactor() { return Derived::kSpeedFactor; } // Коефіцієнт швидкості
+    static constexpr double acceleration() { return Derived::kAcceleration; } // Прискорення, м/с^2
+    static constexpr int capacity() { return Derived::kCapacity; }          // Місткість, пасажирів
+    static constexpr std::string_view icon() { return Derived::kIcon; }   // Іконка для логів/дебагу
 };
 
-// 2. УСПАДКУВАННЯ (Bus inheriting from ITransportModel)
-class BusModel : public ITransportModel {
-public:
-    // 3. ПЕРЕВИЗНАЧЕННЯ (Override)
-    double getDwellTime() const override {
-        return 5.0; // Автобус стоїть 5 секунд (стандарт)
-    }
-    double getSpeedFactor() const override {
-        return 1.0; // 100% швидкості
-    }
-    std::string getIcon() const override {
-        return "🚌";
-    }
+// 2. УСПАДКУВАННЯ (Bus inheriting from TransportModel)
+struct BusModel : TransportModel<BusModel> {
+    // 3. ПЕРЕВИЗНАЧЕННЯ (параметри конкретного типу)
+    static constexpr std::string_view kName = "bus";
+    static constexpr double kDwellTime = 5.0;   // Автобус стоїть 5 секунд (стандарт)
+    static constexpr double kDwellSpread = 2.0;
+    static constexpr double kSpeedFactor = 1.0; // 100% швидкості
+    static constexpr double kAcceleration = 1.2;
+    static constexpr int kCapacity = 90;
+    static constexpr std::string_view kIcon = "🚌";
 };
 
-class TramModel : public ITransportModel {
-public:
-    double getDwellTime() const override {
-        return 8.0; // Трамвай довше висаджує пасажирів (Поліморфізм даних)
-    }
-    double getSpeedFactor() const override {
-        return 0.8; // Трамвай їде повільніше (80% від номіналу)
-    }
-    std::string getIcon() const override {
-        return "🚊";
-    }
+struct TramModel : TransportModel<TramModel> {
+    static constexpr std::string_view kName = "tram";
+    static constexpr double kDwellTime = 8.0;   // Трамвай довше висаджує пасажирів (Поліморфізм даних)
+    static constexpr double kDwellSpread = 3.0;
+    static constexpr double kSpeedFactor = 0.8; // Трамвай їде повільніше (80% від номіналу)
+    static constexpr double kAcceleration = 1.0;
+    static constexpr int kCapacity = 180;
+    static constexpr std::string_view kIcon = "🚊";
 };
 
-class TrolleybusModel : public ITransportModel {
-public:
-    double getDwellTime() const override {
-        return 6.0;
-    }
-    double getSpeedFactor() const override {
-        return 0.9; // Трохи повільніше автобуса
-    }
-    std::string getIcon() const override {
-        return "🚎";
-    }
+struct TrolleybusModel : TransportModel<TrolleybusModel> {
+    static constexpr std::string_view kName = "trolleybus";
+    static constexpr double kDwellTime = 6.0;
+    static constexpr double kDwellSpread = 2.0;
+    static constexpr double kSpeedFactor = 0.9; // Трохи повільніше автобуса
+    static constexpr double kAcceleration = 1.3; // Електротяга розганяється швидше
+    static constexpr int kCapacity = 100;
+    static constexpr std::string_view kIcon = "🚎";
+};
+
+// Єдине місце реєстрації типів: новий тип = нова модель вище + запис тут.
+// Перша модель - тип за замовчуванням для невідомих назв
+template <typename... Models>
+struct ModelList {};
+using TransportModels = ModelList<BusModel, TramModel, TrolleybusModel>;
+
+// Компактний тип ТЗ: індекс моделі в TransportModels
+using VehicleKind = uint8_t;
+
+struct VehicleKindInfo {
+    std::string_view name;
+    std::string_view icon;
+    double dwell_time;
+    double dwell_spread;
+    double speed_factor;
+    double acceleration;
+    int capacity;
 };
 
-#endif // TRANSPORT_MODELS_H
\ No newline at end of file
+template <typename... Models>
+constexpr std::array<VehicleKindInfo, sizeof...(Models)> makeVehicleKinds(ModelList<Models...>) {
+    return {{{Models::name(), Models::icon(), Models::dwellTime(), Models::dwellSpread(),
+              Models::speedFactor(), Models::acceleration(), Models::capacity()}...}};
+}
+
+// Таблиця параметрів за замовчуванням, зібрана під час компіляції.
+// Нею заповнюється таблиця vehicle_types у БД; у симуляції діють значення з БД
+// (див. VehicleTypes), індекси вбудованих типів збігаються
+inline constexpr auto kVehicleKinds = makeVehicleKinds(TransportModels{});
+
+inline VehicleKind vehicleKindFor(std::string_view type) {
+    for (size_t kind = 0; kind < kVehicleKinds.size(); ++kind) {
+        if (kVehicleKinds[kind].name == type) {
+            return static_cast<VehicleKind>(kind);
+        }
+    }
+    return 0;
+}
+
+#endif // TRANSPORT_MODELS_H
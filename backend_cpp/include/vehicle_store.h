@@ -0,0 +1,130 @@
+#ifndef VEHICLE_STORE_H
+#define VEHICLE_STORE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include "kinematics.h"
+#include "symbol_table.h"
+#include "topology.h"
+#include "transport_models.h"
+#include "vehicle_types.h"
+
+// Static per-vehicle metadata, captured once when the vehicle is added
+struct VehicleInfo {
+    Symbol route_name;
+    Symbol type;
+};
+
+// Structure-of-arrays state of all simulated vehicles.
+// Every column has size() entries; slot i of each column belongs to the same
+// vehicle, so the tick streams linearly through memory.
+class VehicleStore {
+public:
+    std::vector<int> vehicle_id;
+    std::vector<int> route_index; // index into Topology::routes()
+    std::vector<int> stop_idx;    // current stop within the route
+    std::vector<double> x;
+    std::vector<double> y;
+    // Current segment, copied from the route's segment table on departure
+    // (reversed when driving backwards)
+    std::vector<double> start_x;
+    std::vector<double> start_y;
+    std::vector<double> dir_x;
+    std::vector<double> dir_y;
+    std::vector<double> length;
+    std::vector<double> inv_length;
+    std::vector<double> travelled; // arc length covered along the segment
+    std::vector<double> base_speed; // km/h, as configured for the vehicle
+    std::vector<double> speed;    // cruise speed, km/h (base_speed * speed_factor)
+    std::vector<double> velocity; // current speed, km/h
+    std::vector<double> accel;    // km/h per second, copied from the type for the kernel
+    std::vector<double> progress; // 0.0 to 1.0
+    std::vector<double> dwell;    // seconds remaining at stop
+    std::vector<uint8_t> forward; // direction
+    std::vector<VehicleKind> kind; // index into VehicleTypes
+    std::vector<uint64_t> rng;     // per-vehicle random stream (dwell times)
+    std::vector<VehicleInfo> info;
+
+    size_t size() const { return vehicle_id.size(); }
+    void clear();
+    void reserve(size_t count);
+
+    // Parameter table that kinds index into; set before adding vehicles.
+    // Defaults to the compiled-in types. Replacing it later leaves speed and
+    // accel as they were until update() reads them from the new table.
+    void setVehicleTypes(std::shared_ptr<const VehicleTypes> types) { types_ = std::move(types); }
+    const VehicleTypes& vehicleTypes() const { return *types_; }
+
+    // Seed of the per-vehicle random streams; each vehicle's stream is
+    // derived from it and the vehicle id, so it does not depend on the order
+    // vehicles are added in. Set before adding vehicles.
+    void setSeed(uint64_t seed) { seed_ = seed; }
+    uint64_t seed() const { return seed_; }
+
+    // Places the vehicle at the first stop of its route, heading to the next one.
+    // Returns the slot of the new vehicle.
+    size_t add(int id, int route, const Topology& topology, double avg_speed,
+               VehicleKind vehicle_kind, VehicleInfo vehicle_info);
+
+    // Copies vehicle i of another store, with all its state, into a new
+    // slot. Both stores must use the same vehicle types. Returns the slot.
+    size_t append(const VehicleStore& other, size_t i);
+
+    // Returns -1 for unknown vehicles
+    int slotOf(int id) const;
+
+    // Removes a vehicle by moving the last slot into its place.
+    // Returns false for unknown vehicles.
+    bool remove(int id);
+
+    // New speed, type or display data; position and route are kept
+    void update(size_t i, double avg_speed, VehicleKind vehicle_kind, VehicleInfo vehicle_info);
+
+    // Puts the vehicle at the first stop of another route
+    void setRoute(size_t i, int route, const Topology& topology);
+
+    // The geometry of the vehicle's route changed: keeps it moving if its
+    // current segment is unchanged, otherwise puts it back at its current
+    // stop (or the first one if the route got shorter). The route must have
+    // stops. Returns false if the vehicle kept its segment.
+    bool retarget(size_t i, const Topology& topology);
+
+    // Resumes a vehicle from saved state on its current route: heading from
+    // stop `stop` in direction `forward`, `travelled` along that segment
+    // (clamped to its length). The stop must exist on the route.
+    void resume(size_t i, const Topology& topology, int stop, bool forward_dir, double travelled_dist,
+                double current_velocity, double dwell_left, uint64_t rng_state);
+
+    // Advances slots [begin, end) by delta_time seconds
+    void advance(const Topology& topology, double delta_time, size_t begin, size_t end);
+    void advance(const Topology& topology, double delta_time) { advance(topology, delta_time, 0, size()); }
+
+    // Hash of the dynamic state of every vehicle, to check that two runs are
+    // bit-identical. Independent of slot order; digests of disjoint stores add up.
+    uint64_t digest() const;
+
+    // Motion kernel variant; defaults to the best one the CPU supports
+    void setSimdLevel(SimdLevel level);
+    SimdLevel simdLevel() const { return simd_level_; }
+
+    // Vehicle i has reached the end of its segment: start dwelling and
+    // take the next segment
+    void arrive(size_t i, const Topology& topology);
+
+private:
+    std::unordered_map<int, size_t> slot_index_;
+    std::shared_ptr<const VehicleTypes> types_ = VehicleTypes::defaults();
+    uint64_t seed_ = 0;
+    SimdLevel simd_level_ = detectSimdLevel();
+    MotionKernel motion_kernel_ = motionKernel(simd_level_);
+
+    // Speed at which a vehicle leaves a stop
+    double departureVelocity(size_t i) const { return accel[i] > 0.0 ? 0.0 : speed[i]; }
+    // Loads the segment leaving stop_idx[i] in the current direction
+    void enterSegment(size_t i, const Topology& topology);
+};
+
+#endif // VEHICLE_STORE_H
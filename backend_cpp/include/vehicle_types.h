@@ -0,0 +1,49 @@
+#ifndef VEHICLE_TYPES_H
+#define VEHICLE_TYPES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include "database.h"
+#include "transport_models.h"
+
+// Simulation parameters of one transport type, in the units the kernel uses
+struct VehicleTypeParams {
+    std::string name;
+    double dwell_mean;   // seconds
+    double dwell_spread; // seconds, uniform +/- around the mean
+    double speed_factor;
+    double acceleration; // km/h per second, 0 = instant
+    int capacity;
+};
+
+// Immutable table of transport types indexed by VehicleKind.
+// Built-in kinds keep their index from transport_models.h; rows of the
+// vehicle_types table override their parameters and may add new types.
+class VehicleTypes {
+public:
+    // Shortest dwell any type can draw, in seconds. build() clamps rows to
+    // it and the admin API rejects types below it. The event core relies on
+    // it: on a route whose segments all have zero length, a vehicle that
+    // never stayed at a stop would keep arriving at the same instant.
+    static constexpr double kMinDwell = 0.1;
+
+    static std::shared_ptr<const VehicleTypes> load(Database& db);
+    static std::shared_ptr<const VehicleTypes> build(const std::vector<VehicleType>& rows);
+    // Compiled-in defaults only
+    static std::shared_ptr<const VehicleTypes> defaults() { return build({}); }
+
+    size_t size() const { return params_.size(); }
+    const VehicleTypeParams& operator[](VehicleKind kind) const { return params_[kind]; }
+
+    // Unknown names map to the default kind 0
+    VehicleKind kindOf(std::string_view name) const;
+
+private:
+    VehicleTypes() = default;
+
+    std::vector<VehicleTypeParams> params_;
+};
+
+#endif // VEHICLE_TYPES_H
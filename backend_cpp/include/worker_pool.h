@@ -0,0 +1,63 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with work stealing for data-parallel loops.
+// The calling thread participates as worker 0, so a pool of size N starts
+// N - 1 background threads.
+class WorkerPool {
+public:
+    using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return queues_.size(); }
+
+    // Splits [0, count) into chunks of `grain` items and runs fn on each chunk.
+    // Each worker starts on its own contiguous share of chunks and steals from
+    // the tail of other workers' shares once it runs dry. Blocks until all
+    // chunks are done.
+    void parallelFor(size_t count, size_t grain, const RangeFn& fn);
+
+private:
+    // Remaining chunks of one worker, packed as [head:32 | tail:32].
+    // The owner takes from head, thieves take from tail.
+    struct alignas(64) ChunkQueue {
+        std::atomic<uint64_t> range{0};
+    };
+
+    std::vector<ChunkQueue> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_ = 0;
+    size_t busy_workers_ = 0;
+    bool shutdown_ = false;
+
+    // Current job, valid while busy_workers_ > 0
+    const RangeFn* fn_ = nullptr;
+    size_t count_ = 0;
+    size_t grain_ = 1;
+
+    void workerLoop(size_t worker);
+    void runChunks(size_t worker);
+    bool popOwn(size_t worker, uint32_t& chunk);
+    bool steal(size_t victim, uint32_t& chunk);
+};
+
+#endif // WORKER_POOL_H
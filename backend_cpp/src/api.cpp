@@ -1,13 +1,87 @@
 #include "api.h"
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 using json = nlohmann::json;
 
+namespace {
+
+// A headless run blocks its request thread until done: at most a simulated
+// week, and at most ten wall minutes when paced
+const double kMaxRunSeconds = 7 * 86400.0;
+const double kMaxPacedRunWallSeconds = 600.0;
+
+json serviceJson(const RouteService& service) {
+    return {
+        {"arrivals", service.arrivals},
+        {"average_headway", service.average_headway},
+        {"average_wait", service.average_wait}
+    };
+}
+
+// Vehicle types are a closed set: names outside it would only grow the
+// symbol table, which never frees an entry
+bool knownVehicleType(const std::vector<VehicleType>& types, const std::string& name) {
+    return std::any_of(types.begin(), types.end(), [&name](const VehicleType& type) { return type.name == name; });
+}
+
+ScenarioSpec scenarioFrom(const json& j, const NetworkData& data) {
+    ScenarioSpec spec;
+    spec.name = j.value("name", "");
+    for (const auto& add : j.value("add_vehicles", json::array())) {
+        AddVehicles vehicles{add.at("route_id").get<int>(), add.value("count", 1),
+                             add.value("type", std::string("bus")), add.value("avg_speed", 30.0)};
+        bool known = std::any_of(data.routes.begin(), data.routes.end(),
+                                 [&vehicles](const Route& route) { return route.id == vehicles.route_id; });
+        if (!known) {
+            throw std::invalid_argument("Unknown route: " + std::to_string(vehicles.route_id));
+        }
+        if (!knownVehicleType(data.vehicle_types, vehicles.type)) {
+            throw std::invalid_argument("Unknown vehicle type: " + vehicles.type);
+        }
+        spec.add_vehicles.push_back(vehicles);
+    }
+    for (const auto& factor : j.value("speed_factor", json::object()).items()) {
+        double value = factor.value().get<double>();
+        if (value <= 0.0) {
+            throw std::invalid_argument("Speed factor must be positive: " + factor.key());
+        }
+        spec.speed_factors[factor.key()] = value;
+    }
+    spec.remove_vehicles = j.value("remove_vehicles", std::vector<int>());
+    return spec;
+}
+
+// Whole string as an unsigned decimal; no sign, spaces or trailing text
+bool parseUnsigned(const std::string& text, uint64_t& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+json positionJson(const VehiclePosition& pos) {
+    return {
+        {"vehicle_id", pos.vehicle_id},
+        {"x", pos.x},
+        {"y", pos.y},
+        {"current_stop_index", pos.current_stop_index},
+        {"next_stop_index", pos.next_stop_index},
+        {"route_name", symbolName(pos.route_name)},
+        {"type", symbolName(pos.type)},
+        {"progress", pos.progress}
+    };
+}
+
+} // namespace
+
 APIServer::APIServer(std::shared_ptr<Database> db, std::shared_ptr<Simulation> sim)
-    : db_(db), sim_(sim), server_(new httplib::Server()) {}
+    : db_(db), sim_(sim), scenarios_(sim->workerThreads()), server_(new httplib::Server()) {}
 
 APIServer::~APIServer() {
     if (server_) {
@@ -21,7 +95,7 @@ void APIServer::setupRoutes() {
     // Enable CORS та Content-Encoding
     svr->set_default_headers({
         {"Access-Control-Allow-Origin", "*"},
-        {"Access-Control-Allow-Methods", "GET, POST, OPTIONS"},
+        {"Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS"},
         {"Access-Control-Allow-Headers", "Content-Type"},
         {"Cache-Control", "no-cache, max-age=0"}
     });
@@ -98,21 +172,20 @@ void APIServer::setupRoutes() {
         }
     });
     
-    // GET /api/transport/live
-    svr->Get("/api/transport/live", [this](const httplib::Request&, httplib::Response& res) {
+    // GET /api/vehicle_types
+    svr->Get("/api/vehicle_types", [this](const httplib::Request&, httplib::Response& res) {
         try {
-            auto positions = sim_->getLivePositions();
+            auto types = db_->getAllVehicleTypes();
             json j = json::array();
-            for (const auto& pos : positions) {
+            for (const auto& type : types) {
                 j.push_back({
-                    {"vehicle_id", pos.vehicle_id},
-                    {"x", pos.x},
-                    {"y", pos.y},
-                    {"current_stop_index", pos.current_stop_index},
-                    {"next_stop_index", pos.next_stop_index},
-                    {"route_name", pos.route_name},
-                    {"type", pos.type},
-                    {"progress", pos.progress}
+                    {"id", type.id},
+                    {"name", type.name},
+                    {"dwell_mean", type.dwell_mean},
+                    {"dwell_spread", type.dwell_spread},
+                    {"speed_factor", type.speed_factor},
+                    {"acceleration", type.acceleration},
+                    {"capacity", type.capacity}
                 });
             }
             res.set_content(j.dump(), "application/json");
@@ -122,6 +195,91 @@ void APIServer::setupRoutes() {
         }
     });
     
+    // GET /api/transport/live[?since=<version>]
+    svr->Get("/api/transport/live", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto snapshot = sim_->getLiveSnapshot();
+            res.set_header("X-Simulation-Tick", std::to_string(snapshot->tick));
+            res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+            
+            if (!req.has_param("since")) {
+                json j = json::array();
+                for (const auto& pos : snapshot->positions) {
+                    j.push_back(positionJson(pos));
+                }
+                res.set_content(j.dump(), "application/json");
+                return;
+            }
+            
+            // Delta: only vehicles that moved after `since`, or everything
+            // when the reader is too far behind
+            uint64_t since = 0;
+            if (!parseUnsigned(req.get_param_value("since"), since)) {
+                res.status = 400;
+                res.set_content(jsonError("since must be a non-negative integer"), "application/json");
+                return;
+            }
+            std::vector<uint32_t> slots;
+            bool delta = snapshot->changedSince(since, slots);
+            json vehicles = json::array();
+            if (delta) {
+                for (uint32_t slot : slots) {
+                    vehicles.push_back(positionJson(snapshot->positions[slot]));
+                }
+            } else {
+                for (const auto& pos : snapshot->positions) {
+                    vehicles.push_back(positionJson(pos));
+                }
+            }
+            json j = {
+                {"tick", snapshot->tick},
+                {"version", snapshot->version},
+                {"full", !delta},
+                {"vehicles", vehicles}
+            };
+            res.set_content(j.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.set_content(jsonError(e.what(), 500), "application/json");
+        }
+    });
+    
+    // GET /api/transport/live/box?min_x=..&min_y=..&max_x=..&max_y=..
+    // Live positions inside a viewport, served from the snapshot's spatial grid
+    svr->Get("/api/transport/live/box", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            for (const char* param : {"min_x", "min_y", "max_x", "max_y"}) {
+                if (!req.has_param(param)) {
+                    res.status = 400;
+                    res.set_content(jsonError(std::string("Missing parameter: ") + param), "application/json");
+                    return;
+                }
+            }
+            Bounds box{std::stod(req.get_param_value("min_x")), std::stod(req.get_param_value("min_y")),
+                       std::stod(req.get_param_value("max_x")), std::stod(req.get_param_value("max_y"))};
+            // std::stod also accepts "nan" and "inf"
+            bool finite = std::isfinite(box.min_x) && std::isfinite(box.min_y) &&
+                          std::isfinite(box.max_x) && std::isfinite(box.max_y);
+            if (!finite || box.max_x < box.min_x || box.max_y < box.min_y) {
+                res.status = 400;
+                res.set_content(jsonError("Bounds must be finite with min <= max"), "application/json");
+                return;
+            }
+            
+            auto snapshot = sim_->getLiveSnapshot();
+            res.set_header("X-Simulation-Tick", std::to_string(snapshot->tick));
+            res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+            json j = json::array();
+            for (const auto& pos : snapshot->inBox(box)) {
+                j.push_back(positionJson(pos));
+            }
+            res.set_content(j.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(jsonError(e.what(), 400), "application/json");
+        }
+    });
+    
     // POST /api/admin/stop
     svr->Post("/api/admin/stop", [this](const httplib::Request& req, httplib::Response& res) {
         try {
@@ -134,7 +292,8 @@ void APIServer::setupRoutes() {
             stop.x = body["x"];
             stop.y = body["y"];
             
-            if (db_->createOrUpdateStop(stop)) {
+            if (db_->createOrUpdateStop(stop, &stop.id)) {
+                sim_->upsertStop(stop);
                 res.set_content(jsonSuccess(), "application/json");
             } else {
                 res.status = 400;
@@ -158,7 +317,8 @@ void APIServer::setupRoutes() {
             route.type = body["type"];
             route.stop_ids = body["stop_ids"].get<std::vector<int>>();
             
-            if (db_->createOrUpdateRoute(route)) {
+            if (db_->createOrUpdateRoute(route, &route.id)) {
+                sim_->upsertRoute(route);
                 res.set_content(jsonSuccess(), "application/json");
             } else {
                 res.status = 400;
@@ -170,6 +330,43 @@ void APIServer::setupRoutes() {
         }
     });
     
+    // POST /api/admin/vehicle_type
+    svr->Post("/api/admin/vehicle_type", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            json body = json::parse(req.body);
+            VehicleType type;
+            type.id = body.value("id", 0);
+            type.name = body["name"];
+            type.dwell_mean = body["dwell_mean"];
+            type.dwell_spread = body.value("dwell_spread", 0.0);
+            type.speed_factor = body.value("speed_factor", 1.0);
+            type.acceleration = body.value("acceleration", 0.0);
+            type.capacity = body.value("capacity", 0);
+            
+            // Every dwell the type can draw must reach the simulation's minimum
+            if (!(type.dwell_spread >= 0.0) ||
+                !(type.dwell_mean - type.dwell_spread >= VehicleTypes::kMinDwell)) {
+                std::ostringstream message;
+                message << "dwell_spread must not be negative and dwell_mean - dwell_spread must be at least "
+                        << VehicleTypes::kMinDwell << " s";
+                res.status = 400;
+                res.set_content(jsonError(message.str()), "application/json");
+                return;
+            }
+            
+            if (db_->createOrUpdateVehicleType(type)) {
+                sim_->reloadVehicleTypes(db_->getAllVehicleTypes());
+                res.set_content(jsonSuccess(), "application/json");
+            } else {
+                res.status = 400;
+                res.set_content(jsonError("Failed to create/update vehicle type"), "application/json");
+            }
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(jsonError(e.what(), 400), "application/json");
+        }
+    });
+    
     // POST /api/simulation/control
     svr->Post("/api/simulation/control", [this](const httplib::Request& req, httplib::Response& res) {
         try {
@@ -180,6 +377,30 @@ void APIServer::setupRoutes() {
                 sim_->resume();
             } else if (action == "stop") {
                 sim_->pause();
+            } else if (action == "speed") {
+                double time_scale = body["time_scale"];
+                sim_->setTimeScale(time_scale);
+            } else if (action == "engine") {
+                std::string engine = body["engine"];
+                if (engine == "event") {
+                    sim_->setEngine(SimulationEngine::EventDriven);
+                } else if (engine == "tick") {
+                    sim_->setEngine(SimulationEngine::FixedTick);
+                } else {
+                    res.status = 400;
+                    res.set_content(jsonError("Unknown engine: " + engine), "application/json");
+                    return;
+                }
+            } else if (action == "catch_up") {
+                bool enabled = body["enabled"];
+                unsigned max_periods = body.value("max_periods", 10u);
+                sim_->setCatchUp(enabled ? CatchUpPolicy::CatchUp : CatchUpPolicy::Skip, max_periods);
+            } else if (action == "checkpoint") {
+                if (!sim_->checkpoint()) {
+                    res.status = 400;
+                    res.set_content(jsonError("Checkpoints are disabled"), "application/json");
+                    return;
+                }
             }
             
             res.set_content(jsonSuccess(), "application/json");
@@ -192,9 +413,19 @@ void APIServer::setupRoutes() {
     // GET /api/simulation/status
     svr->Get("/api/simulation/status", [this](const httplib::Request&, httplib::Response& res) {
         try {
+            auto snapshot = sim_->getLiveSnapshot();
             json j = {
                 {"running", sim_->isRunning()},
-                {"paused", sim_->isPaused()}
+                {"paused", sim_->isPaused()},
+                {"worker_threads", sim_->workerThreads()},
+                {"seed", sim_->seed()},
+                {"shards", sim_->shardSizes()},
+                {"engine", simulationEngineName(sim_->engine())},
+                {"time_scale", sim_->timeScale()},
+                {"tick", snapshot->tick},
+                {"sim_time", snapshot->sim_time},
+                {"catch_up", sim_->catchUpPolicy() == CatchUpPolicy::CatchUp},
+                {"max_catch_up", sim_->maxCatchUp()}
             };
             res.set_content(j.dump(), "application/json");
         } catch (const std::exception& e) {
@@ -203,6 +434,105 @@ void APIServer::setupRoutes() {
         }
     });
     
+    // GET /api/simulation/metrics
+    // Live loop timing: overruns, dropped time and tick duration histogram
+    svr->Get("/api/simulation/metrics", [this](const httplib::Request&, httplib::Response& res) {
+        try {
+            TickMetrics metrics = sim_->tickMetrics();
+            json histogram = json::array();
+            for (size_t i = 0; i < metrics.histogram.size(); ++i) {
+                json bound = i < kTickHistogramBoundsMs.size() ? json(kTickHistogramBoundsMs[i]) : json(nullptr);
+                histogram.push_back({{"le_ms", bound}, {"count", metrics.histogram[i]}});
+            }
+            json j = {
+                {"ticks", metrics.ticks},
+                {"overruns", metrics.overruns},
+                {"late_wakeups", metrics.late_wakeups},
+                {"skipped_periods", metrics.skipped_periods},
+                {"caught_up_periods", metrics.caught_up_periods},
+                {"mean_tick_ms", metrics.mean_tick_ms},
+                {"max_tick_ms", metrics.max_tick_ms},
+                {"tick_histogram", histogram}
+            };
+            res.set_content(j.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.set_content(jsonError(e.what(), 500), "application/json");
+        }
+    });
+    
+    // POST /api/simulation/run
+    // Headless run of the same model: as fast as possible or at a time multiplier
+    svr->Post("/api/simulation/run", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            json body = json::parse(req.body);
+            double duration = body["duration"];
+            double time_scale = body.value("time_scale", 0.0);
+            if (!(duration > 0.0 && duration <= kMaxRunSeconds) || !(time_scale >= 0.0 && std::isfinite(time_scale)) ||
+                (time_scale > 0.0 && duration / time_scale > kMaxPacedRunWallSeconds)) {
+                res.status = 400;
+                res.set_content(jsonError("duration must be positive and at most a week, and a paced run "
+                                          "at most 600 wall seconds"), "application/json");
+                return;
+            }
+            
+            RunStats stats = sim_->runFor(duration, time_scale);
+            json j = {
+                {"ticks", stats.ticks},
+                {"sim_seconds", stats.sim_seconds},
+                {"wall_seconds", stats.wall_seconds},
+                {"sim_seconds_per_wall_second", stats.simSecondsPerWallSecond()}
+            };
+            res.set_content(j.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(jsonError(e.what()), "application/json");
+        }
+    });
+    
+    // POST /api/simulation/scenarios
+    // What-if runs forked from the live state, compared against an unchanged baseline
+    svr->Post("/api/simulation/scenarios", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            json body = json::parse(req.body);
+            double duration = body["duration"];
+            NetworkData data = db_->getNetworkData();
+            std::vector<ScenarioSpec> specs;
+            for (const auto& scenario : body.value("scenarios", json::array())) {
+                specs.push_back(scenarioFrom(scenario, data));
+            }
+            
+            ScenarioReport report = scenarios_.run(*sim_, data, specs, duration);
+            json results = json::array();
+            for (const auto& result : report.results) {
+                json routes = json::array();
+                for (const auto& route : result.routes) {
+                    json r = serviceJson(route);
+                    r["route_id"] = route.route_id;
+                    r["route_name"] = route.route_name;
+                    routes.push_back(r);
+                }
+                json r = serviceJson(result.total);
+                r["name"] = result.name;
+                r["vehicles"] = result.vehicles;
+                r["wall_seconds"] = result.wall_seconds;
+                r["routes"] = routes;
+                results.push_back(r);
+            }
+            json j = {
+                {"tick", report.tick},
+                {"sim_time", report.sim_time},
+                {"sim_seconds", report.sim_seconds},
+                {"wall_seconds", report.wall_seconds},
+                {"scenarios", results}
+            };
+            res.set_content(j.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(jsonError(e.what()), "application/json");
+        }
+    });
+    
     // POST /api/admin/transport
     svr->Post("/api/admin/transport", [this](const httplib::Request& req, httplib::Response& res) {
         try {
@@ -214,9 +544,23 @@ void APIServer::setupRoutes() {
             vehicle.route_id = body["route_id"];
             vehicle.type = body["type"];
             vehicle.avg_speed = body["avg_speed"];
-            vehicle.route_name = body["route_name"];
             
-            if (db_->createOrUpdateVehicle(vehicle)) {
+            // The route's own name, so vehicles cannot add names of their own
+            Route route = db_->getRouteById(vehicle.route_id);
+            if (route.id == 0) {
+                res.status = 400;
+                res.set_content(jsonError("Unknown route: " + std::to_string(vehicle.route_id)), "application/json");
+                return;
+            }
+            if (!knownVehicleType(db_->getAllVehicleTypes(), vehicle.type)) {
+                res.status = 400;
+                res.set_content(jsonError("Unknown vehicle type: " + vehicle.type), "application/json");
+                return;
+            }
+            vehicle.route_name = route.name;
+            
+            if (db_->createOrUpdateVehicle(vehicle, &vehicle.id)) {
+                sim_->upsertVehicle(vehicle);
                 res.set_content(jsonSuccess(), "application/json");
             } else {
                 res.status = 400;
@@ -227,6 +571,23 @@ void APIServer::setupRoutes() {
             res.set_content(jsonError(e.what(), 400), "application/json");
         }
     });
+    
+    // DELETE /api/admin/transport/<id>
+    svr->Delete(R"(/api/admin/transport/(\d+))", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            int id = std::stoi(req.matches[1]);
+            if (db_->deleteVehicle(id)) {
+                sim_->removeVehicle(id);
+                res.set_content(jsonSuccess(), "application/json");
+            } else {
+                res.status = 400;
+                res.set_content(jsonError("Failed to delete vehicle"), "application/json");
+            }
+        } catch (const std::exception& e) {
+            res.status = 400;
+            res.set_content(jsonError(e.what(), 400), "application/json");
+        }
+    });
 }
 
 void APIServer::run(int port) {
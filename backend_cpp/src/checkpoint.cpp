@@ -0,0 +1,192 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+const char kMagic[4] = {'T', 'S', 'C', 'K'};
+// Bump on any layout change; older files are then ignored rather than misread
+const uint32_t kFormatVersion = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version; // also catches files written with the other byte order
+    uint64_t tick;
+    double sim_time;
+    uint64_t count;
+};
+static_assert(sizeof(Header) == 32, "checkpoint header must not contain padding");
+
+// travelled, velocity, dwell, rng | vehicle_id, route_id, stop_idx | forward
+const size_t kBytesPerVehicle = 4 * 8 + 3 * 4 + 1;
+
+template <typename T>
+char* putColumn(char* out, const std::vector<T>& column) {
+    std::memcpy(out, column.data(), column.size() * sizeof(T));
+    return out + column.size() * sizeof(T);
+}
+
+template <typename T>
+const char* getColumn(const char* in, size_t count, std::vector<T>& column) {
+    column.resize(count);
+    std::memcpy(column.data(), in, count * sizeof(T));
+    return in + count * sizeof(T);
+}
+
+} // namespace
+
+std::vector<char> Checkpoint::encode(const std::vector<const VehicleStore*>& stores,
+                                     const Topology& topology, uint64_t tick, double sim_time) {
+    size_t count = 0;
+    for (const VehicleStore* store : stores) {
+        count += store->size();
+    }
+    std::vector<char> image(sizeof(Header) + count * kBytesPerVehicle);
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.tick = tick;
+    header.sim_time = sim_time;
+    header.count = count;
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    // Column by column, each column the concatenation of the stores' columns
+    char* out = image.data() + sizeof(header);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->travelled);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->velocity);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->dwell);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->rng);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->vehicle_id);
+    // Route ids rather than indices: indices are not stable across restarts
+    for (const VehicleStore* store : stores) {
+        for (size_t i = 0; i < store->size(); ++i) {
+            int route_id = topology.route(store->route_index[i]).route_id;
+            std::memcpy(out, &route_id, sizeof(route_id));
+            out += sizeof(route_id);
+        }
+    }
+    for (const VehicleStore* store : stores) out = putColumn(out, store->stop_idx);
+    for (const VehicleStore* store : stores) out = putColumn(out, store->forward);
+    return image;
+}
+
+bool Checkpoint::read(const std::string& path, Checkpoint& checkpoint) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Header header;
+    if (image.size() < sizeof(header)) {
+        std::cerr << "Checkpoint " << path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kFormatVersion) {
+        std::cerr << "Checkpoint " << path << " has an unsupported format" << std::endl;
+        return false;
+    }
+    if (header.count > (image.size() - sizeof(header)) / kBytesPerVehicle ||
+        image.size() != sizeof(header) + header.count * kBytesPerVehicle) {
+        std::cerr << "Checkpoint " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    const size_t count = header.count;
+    std::vector<double> travelled, velocity, dwell;
+    std::vector<uint64_t> rng;
+    std::vector<int> vehicle_id, route_id, stop_idx;
+    std::vector<uint8_t> forward;
+
+    const char* in = image.data() + sizeof(header);
+    in = getColumn(in, count, travelled);
+    in = getColumn(in, count, velocity);
+    in = getColumn(in, count, dwell);
+    in = getColumn(in, count, rng);
+    in = getColumn(in, count, vehicle_id);
+    in = getColumn(in, count, route_id);
+    in = getColumn(in, count, stop_idx);
+    getColumn(in, count, forward);
+
+    checkpoint.tick = header.tick;
+    checkpoint.sim_time = header.sim_time;
+    checkpoint.vehicles.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        checkpoint.vehicles[i] = {vehicle_id[i], route_id[i], stop_idx[i], forward[i] != 0,
+                                  travelled[i], velocity[i], dwell[i], rng[i]};
+    }
+    return true;
+}
+
+bool Checkpoint::write(const std::string& path, const std::vector<char>& image) {
+    const std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot open checkpoint " << temp_path << std::endl;
+        return false;
+    }
+    bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::cerr << "Failed to write checkpoint " << temp_path << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        // Windows does not rename over an existing file
+        std::remove(path.c_str());
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            std::cerr << "Failed to replace checkpoint " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path)
+    : path_(std::move(path)), thread_(&CheckpointWriter::run, this) {
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void CheckpointWriter::submit(std::vector<char> image) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = std::move(image);
+        has_pending_ = true;
+    }
+    wake_.notify_one();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return !has_pending_ && !writing_; });
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return has_pending_ || stopping_; });
+        if (!has_pending_) break; // stopping, nothing left to write
+
+        std::vector<char> image = std::move(pending_);
+        has_pending_ = false;
+        writing_ = true;
+        lock.unlock();
+        Checkpoint::write(path_, image);
+        lock.lock();
+        writing_ = false;
+        idle_.notify_all();
+    }
+}
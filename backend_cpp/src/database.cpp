@@ -1,23 +1,363 @@
 #include "database.h"
+#include "transport_models.h"
 #include <iostream>
-#include <sstream>
 #include <algorithm>
 
-Database::Database(const std::string& db_path) : db_path_(db_path), db_(nullptr) {}
+namespace {
 
+// How long a connection retries when another one holds the lock it needs
+const int kBusyTimeoutMs = 5000;
+
+// Set once on the writer; WAL lets readers run alongside it, and with
+// synchronous=NORMAL a commit is only appended to the log, which is synced
+// at checkpoints. A power cut can lose the last commits but not corrupt.
+const char* const kWriterPragmas =
+    "PRAGMA journal_mode = WAL;"
+    "PRAGMA synchronous = NORMAL;"
+    "PRAGMA temp_store = MEMORY;";
+
+// Per connection: a 16 MiB page cache, and the file mapped (up to 256 MiB)
+// so reads copy out of the OS page cache instead of through read()
+const char* const kConnectionPragmas =
+    "PRAGMA cache_size = -16384;"
+    "PRAGMA mmap_size = 268435456;";
+
+// Parameters are bound without copying: the values outlive the statement's
+// use, and StatementReset clears them before the caller's data goes away
+void bindValue(sqlite3_stmt* stmt, int index, int value) {
+    sqlite3_bind_int(stmt, index, value);
+}
+
+void bindValue(sqlite3_stmt* stmt, int index, double value) {
+    sqlite3_bind_double(stmt, index, value);
+}
+
+void bindValue(sqlite3_stmt* stmt, int index, const std::string& value) {
+    sqlite3_bind_text(stmt, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+void bindAll(sqlite3_stmt*) {
+}
+
+template <typename... Args>
+void bindAll(sqlite3_stmt* stmt, const Args&... args) {
+    int index = 0;
+    (bindValue(stmt, ++index, args), ...);
+}
+
+// Reads the columns of the current row in order, in their stored types:
+// numbers are never formatted to text and parsed back
+class RowReader {
+public:
+    explicit RowReader(sqlite3_stmt* stmt) : stmt_(stmt) {}
+
+    int integer() { return sqlite3_column_int(stmt_, column_++); }
+    double real() { return sqlite3_column_double(stmt_, column_++); }
+    std::string text() {
+        const unsigned char* value = sqlite3_column_text(stmt_, column_);
+        int bytes = sqlite3_column_bytes(stmt_, column_++);
+        return value ? std::string(reinterpret_cast<const char*>(value), bytes) : std::string();
+    }
+    bool null() const { return sqlite3_column_type(stmt_, column_) == SQLITE_NULL; }
+    void skip(int columns) { column_ += columns; }
+
+private:
+    sqlite3_stmt* stmt_;
+    int column_ = 0;
+};
+
+// One overload per row type, matching the column order of its queries
+void readRow(RowReader& row, Stop& stop) {
+    stop.id = row.integer();
+    stop.name = row.text();
+    stop.x = row.real();
+    stop.y = row.real();
+}
+
+void readRow(RowReader& row, RouteStop& rs) {
+    rs.route_id = row.integer();
+    rs.stop_id = row.integer();
+    rs.order_index = row.integer();
+}
+
+void readRow(RowReader& row, Vehicle& vehicle) {
+    vehicle.id = row.integer();
+    vehicle.route_id = row.integer();
+    vehicle.type = row.text();
+    vehicle.avg_speed = row.real();
+    vehicle.route_name = row.text();
+}
+
+// Route columns followed by one stop id, rows ordered by route then stop
+// order (stop id NULL for a route without stops): consecutive rows of the
+// same route are folded into one Route
+void readRouteStopRow(RowReader& row, std::vector<Route>& routes) {
+    int id = row.integer();
+    if (routes.empty() || routes.back().id != id) {
+        Route route;
+        route.id = id;
+        route.name = row.text();
+        route.type = row.text();
+        routes.push_back(std::move(route));
+    } else {
+        row.skip(2);
+    }
+    if (!row.null()) {
+        routes.back().stop_ids.push_back(row.integer());
+    }
+}
+
+void readRow(RowReader& row, VehicleType& type) {
+    type.id = row.integer();
+    type.name = row.text();
+    type.dwell_mean = row.real();
+    type.dwell_spread = row.real();
+    type.speed_factor = row.real();
+    type.acceleration = row.real();
+    type.capacity = row.integer();
+}
+
+// Returns a cached statement to its initial state on scope exit, so it does
+// not keep a read transaction open or refer to bound values between calls
+struct StatementReset {
+    sqlite3_stmt* stmt;
+
+    ~StatementReset() {
+        if (stmt) {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+    }
+};
+
+} // namespace
+
+Database::Database(const std::string& db_path, size_t max_readers)
+    : db_path_(db_path),
+      max_readers_(max_readers > 0 ? max_readers : std::max(1u, std::thread::hardware_concurrency())) {}
+
+// The readers are closed before the writer, so the last connection to go
+// checkpoints the WAL back into the database file
 Database::~Database() {
-    if (db_) {
-        sqlite3_close(db_);
+    idle_readers_.clear();
+    readers_.clear();
+}
+
+Database::Connection::~Connection() {
+    for (auto& cached : statements) {
+        sqlite3_finalize(cached.second);
+    }
+    if (handle) {
+        sqlite3_close(handle);
+    }
+}
+
+sqlite3_stmt* Database::Connection::statement(const std::string& sql) {
+    auto it = statements.find(sql);
+    if (it != statements.end()) {
+        return it->second;
+    }
+    
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "SQL error: " << sqlite3_errmsg(handle) << std::endl;
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    statements.emplace(sql, stmt);
+    return stmt;
+}
+
+thread_local Database::ReadSnapshot* Database::thread_snapshot_ = nullptr;
+
+Database::ReadLease::ReadLease(Database& db) : db_(db) {
+    if (db_.transaction_thread_ != std::this_thread::get_id()) {
+        for (ReadSnapshot* snapshot = thread_snapshot_; snapshot; snapshot = snapshot->outer_) {
+            if (&snapshot->db_ == &db_) {
+                connection_ = &snapshot->lease_.connection();
+                pinned_ = true;
+                return;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(db_.readers_mutex_);
+        db_.reader_returned_.wait(lock, [this] {
+            return !db_.idle_readers_.empty() || db_.readers_.size() < db_.max_readers_;
+        });
+        if (!db_.idle_readers_.empty()) {
+            connection_ = db_.idle_readers_.back();
+            db_.idle_readers_.pop_back();
+            return;
+        }
+        auto reader = std::make_unique<Connection>();
+        if (db_.openReader(*reader)) {
+            connection_ = reader.get();
+            db_.readers_.push_back(std::move(reader));
+            return;
+        }
+    }
+    writer_lock_ = std::unique_lock<std::recursive_mutex>(db_.write_mutex_);
+    connection_ = &db_.writer_;
+}
+
+Database::ReadLease::~ReadLease() {
+    if (pinned_ || writer_lock_.owns_lock()) return;
+    {
+        std::lock_guard<std::mutex> lock(db_.readers_mutex_);
+        db_.idle_readers_.push_back(connection_);
+    }
+    db_.reader_returned_.notify_one();
+}
+
+Database::ReadSnapshot::ReadSnapshot(Database& db)
+    : db_(db), lease_(db), outer_(thread_snapshot_) {
+    sqlite3* handle = lease_.connection().handle;
+    // Already inside the writer's transaction, which reads a single state
+    if (sqlite3_get_autocommit(handle)) {
+        began_ = sqlite3_exec(handle, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    thread_snapshot_ = this;
+}
+
+Database::ReadSnapshot::~ReadSnapshot() {
+    thread_snapshot_ = outer_;
+    if (began_) {
+        sqlite3_exec(lease_.connection().handle, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+}
+
+bool Database::openReader(Connection& reader) {
+    int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(db_path_.c_str(), &reader.handle, flags, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open reader: " << sqlite3_errmsg(reader.handle) << std::endl;
+        return false;
+    }
+    sqlite3_busy_timeout(reader.handle, kBusyTimeoutMs);
+    sqlite3_exec(reader.handle, kConnectionPragmas, nullptr, nullptr, nullptr);
+    return true;
+}
+
+template <typename... Args>
+bool Database::execute(const std::string& sql, const Args&... args) {
+    std::lock_guard<std::recursive_mutex> lock(write_mutex_);
+    sqlite3_stmt* stmt = writer_.statement(sql);
+    if (!stmt) return false;
+    StatementReset reset{stmt};
+    
+    bindAll(stmt, args...);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "SQL error: " << sqlite3_errmsg(writer_.handle) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Fn, typename... Args>
+bool Database::forEachRow(const std::string& sql, Fn fn, const Args&... args) {
+    ReadLease lease(*this);
+    Connection& connection = lease.connection();
+    sqlite3_stmt* stmt = connection.statement(sql);
+    if (!stmt) return false;
+    StatementReset reset{stmt};
+    
+    bindAll(stmt, args...);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        RowReader row(stmt);
+        fn(row);
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "SQL error: " << sqlite3_errmsg(connection.handle) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename T, typename... Args>
+std::vector<T> Database::queryRows(const std::string& sql, size_t size_hint, const Args&... args) {
+    std::vector<T> rows;
+    rows.reserve(size_hint);
+    forEachRow(sql, [&rows](RowReader& row) {
+        rows.emplace_back();
+        readRow(row, rows.back());
+    }, args...);
+    return rows;
+}
+
+template <typename T, typename... Args>
+bool Database::queryRow(const std::string& sql, T& result, const Args&... args) {
+    ReadLease lease(*this);
+    sqlite3_stmt* stmt = lease.connection().statement(sql);
+    if (!stmt) return false;
+    StatementReset reset{stmt};
+    
+    bindAll(stmt, args...);
+    if (sqlite3_step(stmt) != SQLITE_ROW) return false;
+    RowReader row(stmt);
+    readRow(row, result);
+    return true;
+}
+
+size_t Database::countRows(const std::string& table) {
+    ReadLease lease(*this);
+    sqlite3_stmt* stmt = lease.connection().statement("SELECT COUNT(*) FROM " + table + ";");
+    if (!stmt) return 0;
+    StatementReset reset{stmt};
+    return sqlite3_step(stmt) == SQLITE_ROW ? static_cast<size_t>(sqlite3_column_int64(stmt, 0)) : 0;
+}
+
+Database::Transaction::Transaction(Database& db) : db_(db), lock_(db.write_mutex_) {
+    if (db_.transaction_depth_++ == 0) {
+        db_.transaction_thread_ = std::this_thread::get_id();
+        db_.transaction_open_ = db_.execute("BEGIN IMMEDIATE;");
+        db_.transaction_failed_ = !db_.transaction_open_;
+    }
+}
+
+Database::Transaction::~Transaction() {
+    if (!done_) {
+        finish(false);
+    }
+}
+
+bool Database::Transaction::commit() {
+    return !done_ && finish(true);
+}
+
+bool Database::Transaction::finish(bool commit) {
+    done_ = true;
+    if (!commit) {
+        db_.transaction_failed_ = true;
+    }
+    if (--db_.transaction_depth_ > 0) {
+        return !db_.transaction_failed_; // the outermost transaction decides
     }
+    
+    db_.transaction_thread_ = std::thread::id();
+    if (!db_.transaction_open_) return false;
+    db_.transaction_open_ = false;
+    if (!db_.transaction_failed_ && db_.execute("COMMIT;")) {
+        return true;
+    }
+    db_.execute("ROLLBACK;");
+    return false;
 }
 
 bool Database::initialize() {
-    int rc = sqlite3_open(db_path_.c_str(), &db_);
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    int rc = sqlite3_open_v2(db_path_.c_str(), &writer_.handle, flags, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Cannot open database: " << sqlite3_errmsg(db_) << std::endl;
+        std::cerr << "Cannot open database: " << sqlite3_errmsg(writer_.handle) << std::endl;
+        return false;
+    }
+    sqlite3_busy_timeout(writer_.handle, kBusyTimeoutMs);
+    if (!executeQuery(kWriterPragmas) || !executeQuery(kConnectionPragmas)) {
         return false;
     }
-    return createTables() && insertSampleData();
+    return createTables() && insertDefaultVehicleTypes() && insertSampleData();
 }
 
 bool Database::createTables() {
@@ -44,6 +384,10 @@ bool Database::createTables() {
         "FOREIGN KEY(stop_id) REFERENCES stops(id)"
         ");",
         
+        // Covers route loading: a route's stops in order, without touching the table
+        "CREATE INDEX IF NOT EXISTS idx_route_stops_route "
+        "ON route_stops(route_id, order_index, stop_id);",
+        
         "CREATE TABLE IF NOT EXISTS vehicles ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "route_id INTEGER NOT NULL,"
@@ -51,6 +395,16 @@ bool Database::createTables() {
         "avg_speed REAL NOT NULL,"
         "route_name TEXT NOT NULL,"
         "FOREIGN KEY(route_id) REFERENCES routes(id)"
+        ");",
+        
+        "CREATE TABLE IF NOT EXISTS vehicle_types ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "name TEXT NOT NULL UNIQUE,"
+        "dwell_mean REAL NOT NULL,"
+        "dwell_spread REAL NOT NULL DEFAULT 0,"
+        "speed_factor REAL NOT NULL DEFAULT 1,"
+        "acceleration REAL NOT NULL DEFAULT 0,"
+        "capacity INTEGER NOT NULL DEFAULT 0"
         ");"
     };
 
@@ -64,25 +418,11 @@ bool Database::createTables() {
 
 bool Database::insertSampleData() {
     // Check if data already exists
-    std::string check = "SELECT COUNT(*) FROM stops;";
-    int count = 0;
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        int* count = static_cast<int*>(data);
-        if (argc > 0) {
-            *count = std::stoi(argv[0]);
-        }
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, check.c_str(), callback, &count, &errMsg);
-    if (errMsg) {
-        sqlite3_free(errMsg);
-    }
-    
-    if (count > 0) {
+    if (countRows("stops") > 0) {
         return true; // Data already exists
     }
+    Transaction transaction(*this);
+    if (!transaction.ok()) return false;
 
     // Insert stops
     std::vector<std::pair<std::string, std::pair<double, double>>> stops = {
@@ -97,10 +437,8 @@ bool Database::insertSampleData() {
     };
 
     for (const auto& stop : stops) {
-        std::ostringstream oss;
-        oss << "INSERT INTO stops (name, x, y) VALUES ('"
-            << stop.first << "', " << stop.second.first << ", " << stop.second.second << ");";
-        if (!executeQuery(oss.str())) {
+        if (!execute("INSERT INTO stops (name, x, y) VALUES (?, ?, ?);",
+                     stop.first, stop.second.first, stop.second.second)) {
             return false;
         }
     }
@@ -115,10 +453,7 @@ bool Database::insertSampleData() {
     };
 
     for (const auto& route : routes) {
-        std::ostringstream oss;
-        oss << "INSERT INTO routes (name, type) VALUES ('"
-            << route.first << "', '" << route.second << "');";
-        if (!executeQuery(oss.str())) {
+        if (!execute("INSERT INTO routes (name, type) VALUES (?, ?);", route.first, route.second)) {
             return false;
         }
     }
@@ -136,10 +471,8 @@ bool Database::insertSampleData() {
     for (const auto& rs : routeStops) {
         int route_id = rs.first;
         for (size_t i = 0; i < rs.second.size(); ++i) {
-            std::ostringstream oss;
-            oss << "INSERT INTO route_stops (route_id, stop_id, order_index) VALUES ("
-                << route_id << ", " << rs.second[i] << ", " << i << ");";
-            if (!executeQuery(oss.str())) {
+            if (!execute("INSERT INTO route_stops (route_id, stop_id, order_index) VALUES (?, ?, ?);",
+                         route_id, rs.second[i], static_cast<int>(i))) {
                 return false;
             }
         }
@@ -158,21 +491,35 @@ bool Database::insertSampleData() {
     };
 
     for (const auto& v : vehicles) {
-        std::ostringstream oss;
-        oss << "INSERT INTO vehicles (route_id, type, avg_speed, route_name) VALUES ("
-            << std::get<0>(v) << ", '" << std::get<1>(v) << "', "
-            << std::get<2>(v) << ", '" << std::get<3>(v) << "');";
-        if (!executeQuery(oss.str())) {
+        if (!execute("INSERT INTO vehicles (route_id, type, avg_speed, route_name) VALUES (?, ?, ?, ?);",
+                     std::get<0>(v), std::get<1>(v), std::get<2>(v), std::get<3>(v))) {
             return false;
         }
     }
 
-    return true;
+    return transaction.commit();
+}
+
+bool Database::insertDefaultVehicleTypes() {
+    // Built-in types from transport_models.h; rows edited by hand are kept
+    Transaction transaction(*this);
+    if (!transaction.ok()) return false;
+    for (const auto& kind : kVehicleKinds) {
+        if (!execute("INSERT OR IGNORE INTO vehicle_types "
+                     "(name, dwell_mean, dwell_spread, speed_factor, acceleration, capacity) "
+                     "VALUES (?, ?, ?, ?, ?, ?);",
+                     std::string(kind.name), kind.dwell_time, kind.dwell_spread,
+                     kind.speed_factor, kind.acceleration, kind.capacity)) {
+            return false;
+        }
+    }
+    return transaction.commit();
 }
 
 bool Database::executeQuery(const std::string& query) {
+    std::lock_guard<std::recursive_mutex> lock(write_mutex_);
     char* errMsg = nullptr;
-    int rc = sqlite3_exec(db_, query.c_str(), nullptr, nullptr, &errMsg);
+    int rc = sqlite3_exec(writer_.handle, query.c_str(), nullptr, nullptr, &errMsg);
     if (rc != SQLITE_OK) {
         std::cerr << "SQL error: " << errMsg << std::endl;
         sqlite3_free(errMsg);
@@ -182,250 +529,143 @@ bool Database::executeQuery(const std::string& query) {
 }
 
 std::vector<Stop> Database::getAllStops() {
-    std::vector<Stop> stops;
-    std::string query = "SELECT id, name, x, y FROM stops ORDER BY id;";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        std::vector<Stop>* stops = static_cast<std::vector<Stop>*>(data);
-        Stop stop;
-        stop.id = std::stoi(argv[0]);
-        stop.name = argv[1];
-        stop.x = std::stod(argv[2]);
-        stop.y = std::stod(argv[3]);
-        stops->push_back(stop);
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, query.c_str(), callback, &stops, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
-    return stops;
+    return queryRows<Stop>("SELECT id, name, x, y FROM stops ORDER BY id;", countRows("stops"));
 }
 
 Stop Database::getStopById(int id) {
     Stop stop = {0, "", 0.0, 0.0};
-    std::ostringstream oss;
-    oss << "SELECT id, name, x, y FROM stops WHERE id = " << id << ";";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        Stop* stop = static_cast<Stop*>(data);
-        stop->id = std::stoi(argv[0]);
-        stop->name = argv[1];
-        stop->x = std::stod(argv[2]);
-        stop->y = std::stod(argv[3]);
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, oss.str().c_str(), callback, &stop, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
+    queryRow("SELECT id, name, x, y FROM stops WHERE id = ?;", stop, id);
     return stop;
 }
 
-bool Database::createOrUpdateStop(const Stop& stop) {
-    std::ostringstream oss;
-    if (stop.id > 0) {
-        oss << "UPDATE stops SET name = '" << stop.name 
-            << "', x = " << stop.x << ", y = " << stop.y 
-            << " WHERE id = " << stop.id << ";";
-    } else {
-        oss << "INSERT INTO stops (name, x, y) VALUES ('"
-            << stop.name << "', " << stop.x << ", " << stop.y << ");";
+bool Database::createOrUpdateStop(const Stop& stop, int* saved_id) {
+    // Held until the new row id is read
+    std::lock_guard<std::recursive_mutex> lock(write_mutex_);
+    bool saved = stop.id > 0
+        ? execute("UPDATE stops SET name = ?, x = ?, y = ? WHERE id = ?;", stop.name, stop.x, stop.y, stop.id)
+        : execute("INSERT INTO stops (name, x, y) VALUES (?, ?, ?);", stop.name, stop.x, stop.y);
+    if (!saved) return false;
+    if (saved_id) {
+        *saved_id = stop.id > 0 ? stop.id : static_cast<int>(sqlite3_last_insert_rowid(writer_.handle));
     }
-    return executeQuery(oss.str());
+    return true;
 }
 
 std::vector<Route> Database::getAllRoutes() {
+    // One query for all routes and their stops, grouped in a single pass
     std::vector<Route> routes;
-    std::string query = "SELECT id, name, type FROM routes ORDER BY id;";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        std::vector<Route>* routes = static_cast<std::vector<Route>*>(data);
-        Route route;
-        route.id = std::stoi(argv[0]);
-        route.name = argv[1];
-        route.type = argv[2];
-        routes->push_back(route);
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, query.c_str(), callback, &routes, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
-    // Load stop_ids for each route
-    for (auto& route : routes) {
-        auto routeStops = getRouteStops(route.id);
-        for (const auto& rs : routeStops) {
-            route.stop_ids.push_back(rs.stop_id);
-        }
-    }
-    
+    routes.reserve(countRows("routes"));
+    forEachRow("SELECT r.id, r.name, r.type, rs.stop_id FROM routes r "
+               "LEFT JOIN route_stops rs ON rs.route_id = r.id "
+               "ORDER BY r.id, rs.order_index;",
+               [&routes](RowReader& row) { readRouteStopRow(row, routes); });
     return routes;
 }
 
 Route Database::getRouteById(int id) {
-    Route route = {0, "", "", {}};
-    std::ostringstream oss;
-    oss << "SELECT id, name, type FROM routes WHERE id = " << id << ";";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        Route* route = static_cast<Route*>(data);
-        route->id = std::stoi(argv[0]);
-        route->name = argv[1];
-        route->type = argv[2];
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, oss.str().c_str(), callback, &route, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
-    auto routeStops = getRouteStops(id);
-    for (const auto& rs : routeStops) {
-        route.stop_ids.push_back(rs.stop_id);
-    }
-    
-    return route;
+    std::vector<Route> routes;
+    forEachRow("SELECT r.id, r.name, r.type, rs.stop_id FROM routes r "
+               "LEFT JOIN route_stops rs ON rs.route_id = r.id "
+               "WHERE r.id = ? ORDER BY rs.order_index;",
+               [&routes](RowReader& row) { readRouteStopRow(row, routes); }, id);
+    return routes.empty() ? Route{0, "", "", {}} : std::move(routes.front());
 }
 
 std::vector<RouteStop> Database::getRouteStops(int route_id) {
-    std::vector<RouteStop> routeStops;
-    std::ostringstream oss;
-    oss << "SELECT route_id, stop_id, order_index FROM route_stops WHERE route_id = "
-        << route_id << " ORDER BY order_index;";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        std::vector<RouteStop>* routeStops = static_cast<std::vector<RouteStop>*>(data);
-        RouteStop rs;
-        rs.route_id = std::stoi(argv[0]);
-        rs.stop_id = std::stoi(argv[1]);
-        rs.order_index = std::stoi(argv[2]);
-        routeStops->push_back(rs);
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, oss.str().c_str(), callback, &routeStops, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
-    return routeStops;
+    return queryRows<RouteStop>("SELECT route_id, stop_id, order_index FROM route_stops "
+                                "WHERE route_id = ? ORDER BY order_index;", 0, route_id);
 }
 
-bool Database::createOrUpdateRoute(const Route& route) {
-    // This is simplified - in production, you'd want transaction handling
+bool Database::createOrUpdateRoute(const Route& route, int* saved_id) {
+    // All or nothing, and one sync for the whole route however many stops it has
+    Transaction transaction(*this);
+    if (!transaction.ok()) return false;
     int route_id = route.id;
     
     if (route.id > 0) {
-        std::ostringstream oss;
-        oss << "UPDATE routes SET name = '" << route.name 
-            << "', type = '" << route.type << "' WHERE id = " << route.id << ";";
-        if (!executeQuery(oss.str())) return false;
+        if (!execute("UPDATE routes SET name = ?, type = ? WHERE id = ?;", route.name, route.type, route.id)) {
+            return false;
+        }
         
         // Delete old route_stops
-        oss.str("");
-        oss << "DELETE FROM route_stops WHERE route_id = " << route.id << ";";
-        if (!executeQuery(oss.str())) return false;
+        if (!execute("DELETE FROM route_stops WHERE route_id = ?;", route.id)) return false;
     } else {
-        std::ostringstream oss;
-        oss << "INSERT INTO routes (name, type) VALUES ('"
-            << route.name << "', '" << route.type << "');";
-        if (!executeQuery(oss.str())) return false;
-        route_id = sqlite3_last_insert_rowid(db_);
+        if (!execute("INSERT INTO routes (name, type) VALUES (?, ?);", route.name, route.type)) return false;
+        route_id = sqlite3_last_insert_rowid(writer_.handle);
     }
     
     // Insert route_stops
     for (size_t i = 0; i < route.stop_ids.size(); ++i) {
-        std::ostringstream oss;
-        oss << "INSERT INTO route_stops (route_id, stop_id, order_index) VALUES ("
-            << route_id << ", " << route.stop_ids[i] << ", " << i << ");";
-        if (!executeQuery(oss.str())) return false;
+        if (!execute("INSERT INTO route_stops (route_id, stop_id, order_index) VALUES (?, ?, ?);",
+                     route_id, route.stop_ids[i], static_cast<int>(i))) {
+            return false;
+        }
     }
+    if (!transaction.commit()) return false;
     
+    if (saved_id) {
+        *saved_id = route_id;
+    }
     return true;
 }
 
 std::vector<Vehicle> Database::getAllVehicles() {
-    std::vector<Vehicle> vehicles;
-    std::string query = "SELECT id, route_id, type, avg_speed, route_name FROM vehicles ORDER BY id;";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        std::vector<Vehicle>* vehicles = static_cast<std::vector<Vehicle>*>(data);
-        Vehicle vehicle;
-        vehicle.id = std::stoi(argv[0]);
-        vehicle.route_id = std::stoi(argv[1]);
-        vehicle.type = argv[2];
-        vehicle.avg_speed = std::stod(argv[3]);
-        vehicle.route_name = argv[4];
-        vehicles->push_back(vehicle);
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, query.c_str(), callback, &vehicles, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
-    return vehicles;
+    return queryRows<Vehicle>("SELECT id, route_id, type, avg_speed, route_name FROM vehicles ORDER BY id;",
+                              countRows("vehicles"));
 }
 
 Vehicle Database::getVehicleById(int id) {
     Vehicle vehicle = {0, 0, "", 0.0, ""};
-    std::ostringstream oss;
-    oss << "SELECT id, route_id, type, avg_speed, route_name FROM vehicles WHERE id = " << id << ";";
-    
-    auto callback = [](void* data, int argc, char** argv, char** azColName) -> int {
-        Vehicle* vehicle = static_cast<Vehicle*>(data);
-        vehicle->id = std::stoi(argv[0]);
-        vehicle->route_id = std::stoi(argv[1]);
-        vehicle->type = argv[2];
-        vehicle->avg_speed = std::stod(argv[3]);
-        vehicle->route_name = argv[4];
-        return 0;
-    };
-    
-    char* errMsg = nullptr;
-    sqlite3_exec(db_, oss.str().c_str(), callback, &vehicle, &errMsg);
-    if (errMsg) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-    
+    queryRow("SELECT id, route_id, type, avg_speed, route_name FROM vehicles WHERE id = ?;", vehicle, id);
     return vehicle;
 }
 
-bool Database::createOrUpdateVehicle(const Vehicle& vehicle) {
-    std::ostringstream oss;
-    if (vehicle.id > 0) {
-        oss << "UPDATE vehicles SET route_id = " << vehicle.route_id
-            << ", type = '" << vehicle.type 
-            << "', avg_speed = " << vehicle.avg_speed
-            << ", route_name = '" << vehicle.route_name
-            << "' WHERE id = " << vehicle.id << ";";
-    } else {
-        oss << "INSERT INTO vehicles (route_id, type, avg_speed, route_name) VALUES ("
-            << vehicle.route_id << ", '" << vehicle.type << "', "
-            << vehicle.avg_speed << ", '" << vehicle.route_name << "');";
+bool Database::createOrUpdateVehicle(const Vehicle& vehicle, int* saved_id) {
+    std::lock_guard<std::recursive_mutex> lock(write_mutex_);
+    bool saved = vehicle.id > 0
+        ? execute("UPDATE vehicles SET route_id = ?, type = ?, avg_speed = ?, route_name = ? WHERE id = ?;",
+                  vehicle.route_id, vehicle.type, vehicle.avg_speed, vehicle.route_name, vehicle.id)
+        : execute("INSERT INTO vehicles (route_id, type, avg_speed, route_name) VALUES (?, ?, ?, ?);",
+                  vehicle.route_id, vehicle.type, vehicle.avg_speed, vehicle.route_name);
+    if (!saved) return false;
+    if (saved_id) {
+        *saved_id = vehicle.id > 0 ? vehicle.id : static_cast<int>(sqlite3_last_insert_rowid(writer_.handle));
+    }
+    return true;
+}
+
+bool Database::deleteVehicle(int id) {
+    return execute("DELETE FROM vehicles WHERE id = ?;", id);
+}
+
+std::vector<VehicleType> Database::getAllVehicleTypes() {
+    return queryRows<VehicleType>("SELECT id, name, dwell_mean, dwell_spread, speed_factor, acceleration, "
+                                  "capacity FROM vehicle_types ORDER BY id;",
+                                  countRows("vehicle_types"));
+}
+
+bool Database::createOrUpdateVehicleType(const VehicleType& type) {
+    if (type.id > 0) {
+        return execute("UPDATE vehicle_types SET name = ?, dwell_mean = ?, dwell_spread = ?, "
+                       "speed_factor = ?, acceleration = ?, capacity = ? WHERE id = ?;",
+                       type.name, type.dwell_mean, type.dwell_spread, type.speed_factor,
+                       type.acceleration, type.capacity, type.id);
     }
-    return executeQuery(oss.str());
+    return execute("INSERT INTO vehicle_types "
+                   "(name, dwell_mean, dwell_spread, speed_factor, acceleration, capacity) "
+                   "VALUES (?, ?, ?, ?, ?, ?);",
+                   type.name, type.dwell_mean, type.dwell_spread, type.speed_factor,
+                   type.acceleration, type.capacity);
 }
 
+NetworkData Database::getNetworkData() {
+    // One snapshot for all four tables, so a concurrent edit is either
+    // fully in the result or not at all
+    ReadSnapshot snapshot(*this);
+    NetworkData data;
+    data.stops = getAllStops();
+    data.routes = getAllRoutes();
+    data.vehicles = getAllVehicles();
+    data.vehicle_types = getAllVehicleTypes();
+    return data;
+}
@@ -0,0 +1,123 @@
+#include "event_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const char* simulationEngineName(SimulationEngine engine) {
+    return engine == SimulationEngine::EventDriven ? "event" : "tick";
+}
+
+void EventEngine::reset(const VehicleStore& store, double now) {
+    queue_ = {};
+    depart_time_.assign(store.size(), now);
+    next_time_.assign(store.size(), std::numeric_limits<double>::infinity());
+    next_type_.assign(store.size(), EventType::Arrival);
+    generation_.assign(store.size(), 0);
+
+    for (size_t i = 0; i < store.size(); ++i) {
+        start(store, i, now);
+    }
+}
+
+void EventEngine::refresh(const VehicleStore& store, size_t i, double now) {
+    if (i >= depart_time_.size()) {
+        depart_time_.resize(i + 1, now);
+        next_time_.resize(i + 1, std::numeric_limits<double>::infinity());
+        next_type_.resize(i + 1, EventType::Arrival);
+    }
+    if (i >= generation_.size()) {
+        generation_.resize(i + 1, 0);
+    }
+    ++generation_[i]; // drops the pending event, also if none is scheduled below
+    next_time_[i] = std::numeric_limits<double>::infinity();
+    depart_time_[i] = now;
+    start(store, i, now);
+}
+
+void EventEngine::removeSlot(size_t i) {
+    size_t last = depart_time_.size() - 1;
+    if (i != last) {
+        depart_time_[i] = depart_time_[last];
+        ++generation_[i];
+        next_time_[i] = std::numeric_limits<double>::infinity();
+        if (std::isfinite(next_time_[last])) {
+            schedule(i, next_time_[last], next_type_[last]);
+        }
+    }
+    ++generation_[last];
+    depart_time_.pop_back();
+    next_time_.pop_back();
+    next_type_.pop_back();
+}
+
+void EventEngine::start(const VehicleStore& store, size_t i, double now) {
+    if (store.dwell[i] > 0.0) {
+        depart_time_[i] = now + store.dwell[i];
+        schedule(i, depart_time_[i], EventType::Departure);
+    } else {
+        // Already on the way: back-date the departure to match the distance covered
+        double elapsed = timeToCover(store.travelled[i], store.speed[i], store.accel[i]);
+        if (std::isfinite(elapsed)) {
+            depart_time_[i] = now - elapsed;
+        }
+        scheduleArrival(store, i);
+    }
+}
+
+void EventEngine::schedule(size_t i, double time, EventType type) {
+    next_time_[i] = time;
+    next_type_[i] = type;
+    queue_.push({time, static_cast<uint32_t>(i), ++generation_[i]});
+}
+
+void EventEngine::advanceTo(VehicleStore& store, const Topology& topology, double until) {
+    while (!queue_.empty() && queue_.top().time <= until) {
+        Event event = queue_.top();
+        queue_.pop();
+        if (event.generation != generation_[event.slot]) continue; // rescheduled or removed since
+        ++processed_;
+        size_t i = event.slot;
+        next_time_[i] = std::numeric_limits<double>::infinity();
+
+        if (next_type_[i] == EventType::Arrival) {
+            store.arrive(i, topology);
+            // Dwell is at least VehicleTypes::kMinDwell, so time moves on
+            // even on segments of zero length
+            depart_time_[i] = event.time + store.dwell[i];
+            schedule(i, depart_time_[i], EventType::Departure);
+        } else {
+            scheduleArrival(store, i);
+        }
+    }
+}
+
+void EventEngine::scheduleArrival(const VehicleStore& store, size_t i) {
+    double duration = timeToCover(store.length[i], store.speed[i], store.accel[i]);
+    if (!std::isfinite(duration)) return; // parked for good
+    schedule(i, depart_time_[i] + duration, EventType::Arrival);
+}
+
+void EventEngine::materialize(VehicleStore& store, double t, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        double elapsed = t - depart_time_[i];
+        if (elapsed <= 0.0) {
+            // Still at the stop
+            store.dwell[i] = -elapsed;
+            store.velocity[i] = velocityAfter(0.0, store.speed[i], store.accel[i]);
+            store.travelled[i] = 0.0;
+            store.x[i] = store.start_x[i];
+            store.y[i] = store.start_y[i];
+            store.progress[i] = 0.0;
+            continue;
+        }
+
+        double travelled = std::min(store.length[i],
+                                    distanceAfter(elapsed, store.speed[i], store.accel[i]));
+        store.dwell[i] = 0.0;
+        store.velocity[i] = velocityAfter(elapsed, store.speed[i], store.accel[i]);
+        store.travelled[i] = travelled;
+        store.x[i] = store.start_x[i] + store.dir_x[i] * travelled;
+        store.y[i] = store.start_y[i] + store.dir_y[i] * travelled;
+        store.progress[i] = travelled * store.inv_length[i];
+    }
+}
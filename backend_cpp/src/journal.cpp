@@ -0,0 +1,201 @@
+#include "journal.h"
+#include <nlohmann/json.hpp>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+const int kFormatVersion = 1;
+
+template <typename T, typename ToJson>
+json arrayJson(const std::vector<T>& items, ToJson to_json) {
+    json array = json::array();
+    for (const auto& item : items) {
+        array.push_back(to_json(item));
+    }
+    return array;
+}
+
+template <typename T, typename FromJson>
+std::vector<T> arrayFrom(const json& array, FromJson from_json) {
+    std::vector<T> items;
+    items.reserve(array.size());
+    for (const auto& item : array) {
+        items.push_back(from_json(item));
+    }
+    return items;
+}
+
+json stopJson(const Stop& stop) {
+    return {{"id", stop.id}, {"name", stop.name}, {"x", stop.x}, {"y", stop.y}};
+}
+
+json routeJson(const Route& route) {
+    return {{"id", route.id}, {"name", route.name}, {"type", route.type}, {"stop_ids", route.stop_ids}};
+}
+
+json vehicleJson(const Vehicle& vehicle) {
+    return {{"id", vehicle.id}, {"route_id", vehicle.route_id}, {"type", vehicle.type},
+            {"avg_speed", vehicle.avg_speed}, {"route_name", vehicle.route_name}};
+}
+
+json vehicleTypeJson(const VehicleType& type) {
+    return {{"id", type.id}, {"name", type.name}, {"dwell_mean", type.dwell_mean},
+            {"dwell_spread", type.dwell_spread}, {"speed_factor", type.speed_factor},
+            {"acceleration", type.acceleration}, {"capacity", type.capacity}};
+}
+
+Stop stopFrom(const json& j) {
+    return {j.at("id").get<int>(), j.at("name").get<std::string>(), j.at("x").get<double>(),
+            j.at("y").get<double>()};
+}
+
+Route routeFrom(const json& j) {
+    return {j.at("id").get<int>(), j.at("name").get<std::string>(), j.at("type").get<std::string>(),
+            j.at("stop_ids").get<std::vector<int>>()};
+}
+
+Vehicle vehicleFrom(const json& j) {
+    return {j.at("id").get<int>(), j.at("route_id").get<int>(), j.at("type").get<std::string>(),
+            j.at("avg_speed").get<double>(), j.at("route_name").get<std::string>()};
+}
+
+VehicleType vehicleTypeFrom(const json& j) {
+    return {j.at("id").get<int>(), j.at("name").get<std::string>(), j.at("dwell_mean").get<double>(),
+            j.at("dwell_spread").get<double>(), j.at("speed_factor").get<double>(),
+            j.at("acceleration").get<double>(), j.at("capacity").get<int>()};
+}
+
+json commandJson(const DataCommand& command) {
+    if (const auto* stop = std::get_if<Stop>(&command)) return {{"stop", stopJson(*stop)}};
+    if (const auto* route = std::get_if<Route>(&command)) return {{"route", routeJson(*route)}};
+    if (const auto* vehicle = std::get_if<Vehicle>(&command)) return {{"vehicle", vehicleJson(*vehicle)}};
+    if (const auto* types = std::get_if<SetVehicleTypes>(&command)) {
+        return {{"vehicle_types", arrayJson(types->types, vehicleTypeJson)}};
+    }
+    return {{"remove_vehicle", std::get<RemoveVehicle>(command).vehicle_id}};
+}
+
+DataCommand commandFrom(const json& j) {
+    if (j.contains("stop")) return stopFrom(j["stop"]);
+    if (j.contains("route")) return routeFrom(j["route"]);
+    if (j.contains("vehicle")) return vehicleFrom(j["vehicle"]);
+    if (j.contains("vehicle_types")) {
+        return SetVehicleTypes{arrayFrom<VehicleType>(j["vehicle_types"], vehicleTypeFrom)};
+    }
+    return RemoveVehicle{j.at("remove_vehicle").get<int>()};
+}
+
+SimulationEngine engineFrom(const json& j) {
+    return j.get<std::string>() == "event" ? SimulationEngine::EventDriven : SimulationEngine::FixedTick;
+}
+
+json entryJson(uint64_t tick, const JournalInput& input) {
+    json j = {{"tick", tick}};
+    if (const auto* batch = std::get_if<DataBatch>(&input)) {
+        j["data"] = arrayJson(batch->commands, commandJson);
+    } else if (const auto* engine = std::get_if<SetEngine>(&input)) {
+        j["engine"] = simulationEngineName(engine->engine);
+    } else if (const auto* paused = std::get_if<SetPaused>(&input)) {
+        j["paused"] = paused->paused;
+    } else if (const auto* scale = std::get_if<SetTimeScale>(&input)) {
+        j["time_scale"] = scale->time_scale;
+    } else if (const auto* catch_up = std::get_if<SetCatchUp>(&input)) {
+        j["catch_up"] = catch_up->policy == CatchUpPolicy::CatchUp;
+        j["max_periods"] = catch_up->max_catch_up;
+    } else {
+        j["digest"] = std::get<StateDigest>(input).digest;
+    }
+    return j;
+}
+
+JournalInput inputFrom(const json& j) {
+    if (j.contains("data")) return DataBatch{arrayFrom<DataCommand>(j["data"], commandFrom)};
+    if (j.contains("engine")) return SetEngine{engineFrom(j["engine"])};
+    if (j.contains("paused")) return SetPaused{j["paused"].get<bool>()};
+    if (j.contains("time_scale")) return SetTimeScale{j["time_scale"].get<double>()};
+    if (j.contains("catch_up")) {
+        return SetCatchUp{j["catch_up"].get<bool>() ? CatchUpPolicy::CatchUp : CatchUpPolicy::Skip,
+                          j.at("max_periods").get<unsigned>()};
+    }
+    return StateDigest{j.at("digest").get<uint64_t>()};
+}
+
+} // namespace
+
+bool Journal::read(const std::string& path, Journal& journal) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open journal " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    try {
+        if (!std::getline(in, line)) {
+            std::cerr << "Journal " << path << " is empty" << std::endl;
+            return false;
+        }
+        ++line_number;
+        json header = json::parse(line);
+        if (header.at("journal").get<int>() != kFormatVersion) {
+            std::cerr << "Journal " << path << " has an unsupported format" << std::endl;
+            return false;
+        }
+        journal.seed = header.at("seed").get<uint64_t>();
+        journal.engine = engineFrom(header.at("engine"));
+        journal.data.stops = arrayFrom<Stop>(header.at("stops"), stopFrom);
+        journal.data.routes = arrayFrom<Route>(header.at("routes"), routeFrom);
+        journal.data.vehicles = arrayFrom<Vehicle>(header.at("vehicles"), vehicleFrom);
+        journal.data.vehicle_types = arrayFrom<VehicleType>(header.at("vehicle_types"), vehicleTypeFrom);
+
+        journal.entries.clear();
+        while (std::getline(in, line)) {
+            ++line_number;
+            if (line.empty()) continue;
+            json entry = json::parse(line);
+            journal.entries.push_back({entry.at("tick").get<uint64_t>(), inputFrom(entry)});
+        }
+    } catch (const std::exception& e) {
+        // A run killed mid-write leaves a partial last line; everything before it is usable
+        if (in.eof() && line_number > 1) {
+            std::cerr << "Journal " << path << ": ignoring incomplete last line" << std::endl;
+            return true;
+        }
+        std::cerr << "Journal " << path << " line " << line_number << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+JournalWriter::JournalWriter(const std::string& path, const NetworkData& data, uint64_t seed,
+                             SimulationEngine engine)
+    : out_(path, std::ios::trunc) {
+    if (!out_) {
+        std::cerr << "Cannot open journal " << path << std::endl;
+        return;
+    }
+    json header = {
+        {"journal", kFormatVersion},
+        {"seed", seed},
+        {"engine", simulationEngineName(engine)},
+        {"stops", arrayJson(data.stops, stopJson)},
+        {"routes", arrayJson(data.routes, routeJson)},
+        {"vehicles", arrayJson(data.vehicles, vehicleJson)},
+        {"vehicle_types", arrayJson(data.vehicle_types, vehicleTypeJson)}
+    };
+    out_ << header.dump() << '\n';
+    out_.flush();
+}
+
+void JournalWriter::record(uint64_t tick, const JournalInput& input) {
+    if (!out_) return;
+    // Flushed per entry: inputs are rare, and a crash should not lose them
+    out_ << entryJson(tick, input).dump() << '\n';
+    out_.flush();
+    if (std::holds_alternative<StateDigest>(input)) {
+        last_digest_tick_ = tick;
+    }
+}
@@ -0,0 +1,224 @@
+#include "kinematics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KINEMATICS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(KINEMATICS_X86) && defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// The vector variants mirror the scalar arithmetic operation by operation
+// (no FMA, same operand order), so every level yields the same bits.
+
+namespace {
+
+size_t motionScalar(const MotionColumns& c, size_t begin, size_t end, double delta_time,
+                    uint32_t* arrivals) {
+    const double step = delta_time / kKmhPerUnitPerSecond; // units per km/h this tick
+
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (c.dwell[i] > 0.0) {
+            c.dwell[i] -= delta_time;
+            continue;
+        }
+
+        double velocity = std::min(c.velocity[i] + c.accel[i] * delta_time, c.speed[i]);
+        double travelled = c.travelled[i] + velocity * step;
+        if (travelled >= c.length[i]) {
+            arrivals[count++] = static_cast<uint32_t>(i);
+            continue;
+        }
+
+        c.velocity[i] = velocity;
+        c.travelled[i] = travelled;
+        c.x[i] = c.start_x[i] + c.dir_x[i] * travelled;
+        c.y[i] = c.start_y[i] + c.dir_y[i] * travelled;
+        c.progress[i] = travelled * c.inv_length[i];
+    }
+    return count;
+}
+
+#ifdef KINEMATICS_X86
+
+TARGET_SSE2 inline __m128d blendSSE2(__m128d a, __m128d b, __m128d mask) {
+    return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+TARGET_SSE2 size_t motionSSE2(const MotionColumns& c, size_t begin, size_t end,
+                              double delta_time, uint32_t* arrivals) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d dt = _mm_set1_pd(delta_time);
+    const __m128d step = _mm_set1_pd(delta_time / kKmhPerUnitPerSecond);
+
+    size_t count = 0;
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d dwell = _mm_loadu_pd(c.dwell + i);
+        __m128d dwelling = _mm_cmpgt_pd(dwell, zero);
+
+        __m128d old_velocity = _mm_loadu_pd(c.velocity + i);
+        __m128d velocity = _mm_min_pd(_mm_add_pd(old_velocity, _mm_mul_pd(_mm_loadu_pd(c.accel + i), dt)),
+                                      _mm_loadu_pd(c.speed + i));
+        __m128d old_travelled = _mm_loadu_pd(c.travelled + i);
+        __m128d travelled = _mm_add_pd(old_travelled, _mm_mul_pd(velocity, step));
+        __m128d arrived = _mm_andnot_pd(dwelling, _mm_cmpge_pd(travelled, _mm_loadu_pd(c.length + i)));
+        __m128d moving = _mm_andnot_pd(_mm_or_pd(dwelling, arrived), _mm_cmpeq_pd(zero, zero));
+
+        __m128d x = _mm_add_pd(_mm_loadu_pd(c.start_x + i), _mm_mul_pd(_mm_loadu_pd(c.dir_x + i), travelled));
+        __m128d y = _mm_add_pd(_mm_loadu_pd(c.start_y + i), _mm_mul_pd(_mm_loadu_pd(c.dir_y + i), travelled));
+        __m128d progress = _mm_mul_pd(travelled, _mm_loadu_pd(c.inv_length + i));
+
+        _mm_storeu_pd(c.dwell + i, blendSSE2(dwell, _mm_sub_pd(dwell, dt), dwelling));
+        _mm_storeu_pd(c.velocity + i, blendSSE2(old_velocity, velocity, moving));
+        _mm_storeu_pd(c.travelled + i, blendSSE2(old_travelled, travelled, moving));
+        _mm_storeu_pd(c.x + i, blendSSE2(_mm_loadu_pd(c.x + i), x, moving));
+        _mm_storeu_pd(c.y + i, blendSSE2(_mm_loadu_pd(c.y + i), y, moving));
+        _mm_storeu_pd(c.progress + i, blendSSE2(_mm_loadu_pd(c.progress + i), progress, moving));
+
+        int arrived_bits = _mm_movemask_pd(arrived);
+        for (int lane = 0; lane < 2; ++lane) {
+            if (arrived_bits & (1 << lane)) {
+                arrivals[count++] = static_cast<uint32_t>(i + lane);
+            }
+        }
+    }
+    return count + motionScalar(c, i, end, delta_time, arrivals + count);
+}
+
+TARGET_AVX2 size_t motionAVX2(const MotionColumns& c, size_t begin, size_t end,
+                              double delta_time, uint32_t* arrivals) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d dt = _mm256_set1_pd(delta_time);
+    const __m256d step = _mm256_set1_pd(delta_time / kKmhPerUnitPerSecond);
+
+    size_t count = 0;
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d dwell = _mm256_loadu_pd(c.dwell + i);
+        __m256d dwelling = _mm256_cmp_pd(dwell, zero, _CMP_GT_OQ);
+
+        __m256d old_velocity = _mm256_loadu_pd(c.velocity + i);
+        __m256d velocity = _mm256_min_pd(
+            _mm256_add_pd(old_velocity, _mm256_mul_pd(_mm256_loadu_pd(c.accel + i), dt)),
+            _mm256_loadu_pd(c.speed + i));
+        __m256d old_travelled = _mm256_loadu_pd(c.travelled + i);
+        __m256d travelled = _mm256_add_pd(old_travelled, _mm256_mul_pd(velocity, step));
+        __m256d arrived = _mm256_andnot_pd(
+            dwelling, _mm256_cmp_pd(travelled, _mm256_loadu_pd(c.length + i), _CMP_GE_OQ));
+        __m256d moving = _mm256_andnot_pd(_mm256_or_pd(dwelling, arrived),
+                                          _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ));
+
+        __m256d x = _mm256_add_pd(_mm256_loadu_pd(c.start_x + i),
+                                  _mm256_mul_pd(_mm256_loadu_pd(c.dir_x + i), travelled));
+        __m256d y = _mm256_add_pd(_mm256_loadu_pd(c.start_y + i),
+                                  _mm256_mul_pd(_mm256_loadu_pd(c.dir_y + i), travelled));
+        __m256d progress = _mm256_mul_pd(travelled, _mm256_loadu_pd(c.inv_length + i));
+
+        _mm256_storeu_pd(c.dwell + i, _mm256_blendv_pd(dwell, _mm256_sub_pd(dwell, dt), dwelling));
+        _mm256_storeu_pd(c.velocity + i, _mm256_blendv_pd(old_velocity, velocity, moving));
+        _mm256_storeu_pd(c.travelled + i, _mm256_blendv_pd(old_travelled, travelled, moving));
+        _mm256_storeu_pd(c.x + i, _mm256_blendv_pd(_mm256_loadu_pd(c.x + i), x, moving));
+        _mm256_storeu_pd(c.y + i, _mm256_blendv_pd(_mm256_loadu_pd(c.y + i), y, moving));
+        _mm256_storeu_pd(c.progress + i,
+                         _mm256_blendv_pd(_mm256_loadu_pd(c.progress + i), progress, moving));
+
+        int arrived_bits = _mm256_movemask_pd(arrived);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (arrived_bits & (1 << lane)) {
+                arrivals[count++] = static_cast<uint32_t>(i + lane);
+            }
+        }
+    }
+    return count + motionScalar(c, i, end, delta_time, arrivals + count);
+}
+
+bool cpuHasAVX2() {
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    return avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    return false;
+#endif
+}
+
+#endif // KINEMATICS_X86
+
+} // namespace
+
+double distanceAfter(double elapsed, double cruise, double accel) {
+    if (elapsed <= 0.0) return 0.0;
+    if (accel <= 0.0) return unitsPerSecond(cruise) * elapsed;
+
+    double ramp = cruise / accel; // seconds to reach cruise speed
+    if (elapsed < ramp) {
+        return unitsPerSecond(0.5 * accel * elapsed) * elapsed;
+    }
+    return unitsPerSecond(cruise) * (0.5 * ramp + (elapsed - ramp));
+}
+
+double velocityAfter(double elapsed, double cruise, double accel) {
+    if (accel <= 0.0) return cruise;
+    return std::min(cruise, accel * std::max(0.0, elapsed));
+}
+
+double timeToCover(double distance, double cruise, double accel) {
+    if (distance <= 0.0) return 0.0;
+    if (cruise <= 0.0) return std::numeric_limits<double>::infinity();
+    if (accel <= 0.0) return distance / unitsPerSecond(cruise);
+
+    double ramp = cruise / accel;
+    double ramp_distance = unitsPerSecond(0.5 * cruise) * ramp;
+    if (distance < ramp_distance) {
+        // distance = unitsPerSecond(accel / 2) * t^2
+        return std::sqrt(distance / unitsPerSecond(0.5 * accel));
+    }
+    return ramp + (distance - ramp_distance) / unitsPerSecond(cruise);
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef KINEMATICS_X86
+    static const SimdLevel level = cpuHasAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+MotionKernel motionKernel(SimdLevel level) {
+    level = std::min(level, detectSimdLevel());
+#ifdef KINEMATICS_X86
+    if (level == SimdLevel::AVX2) return motionAVX2;
+    if (level == SimdLevel::SSE2) return motionSSE2;
+#endif
+    return motionScalar;
+}
@@ -3,6 +3,8 @@
 #include "simulation.h"
 #include <iostream>
 #include <memory>
+#include <string>
+#include <algorithm>
 #include <signal.h>
 
 std::shared_ptr<Simulation> g_simulation = nullptr;
@@ -21,9 +23,69 @@ int main(int argc, char* argv[]) {
     
     const std::string db_path = "transport.db";
     int port = 8080;
+    size_t worker_threads = 1;
+    double headless_seconds = 0.0; // > 0: run headless for this many sim seconds and exit
+    double time_scale = 0.0;       // headless pace, 0 = as fast as possible
+    SimulationEngine engine = SimulationEngine::FixedTick;
+    std::string checkpoint_path;   // empty: default file when serving, none when headless
+    int checkpoint_every = 60;     // wall seconds between live checkpoints
+    bool checkpoints = true;
+    uint64_t seed = 0;             // per-vehicle random streams
+    std::string journal_path;      // record inputs here
+    std::string replay_path;       // replay this journal and exit
     
-    if (argc > 1) {
-        port = std::stoi(argv[1]);
+    // Usage: transport_backend [port] [worker_threads]
+    //            [--headless <sim_seconds>] [--speed <multiplier>] [--engine tick|event]
+    //            [--checkpoint <file>] [--checkpoint-every <seconds>] [--no-checkpoint]
+    //            [--seed <n>] [--journal <file>] [--replay <file>]
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless" && i + 1 < argc) {
+            headless_seconds = std::stod(argv[++i]);
+        } else if (arg == "--speed" && i + 1 < argc) {
+            time_scale = std::stod(argv[++i]);
+        } else if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            engine = name == "event" ? SimulationEngine::EventDriven : SimulationEngine::FixedTick;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            checkpoint_every = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--no-checkpoint") {
+            checkpoints = false;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (positional == 0) {
+            port = std::stoi(arg);
+            ++positional;
+        } else if (positional == 1) {
+            worker_threads = std::max(1, std::stoi(arg));
+            ++positional;
+        }
+    }
+    
+    if (!replay_path.empty()) {
+        // Everything comes from the journal; the database is not touched
+        Journal journal;
+        if (!Journal::read(replay_path, journal)) {
+            return 1;
+        }
+        Simulation replay(journal.data, worker_threads, journal.seed);
+        ReplayStats stats = replay.replay(journal);
+        std::cout << "Replayed " << stats.ticks << " ticks and " << stats.inputs << " inputs in "
+                  << stats.wall_seconds << " s wall on " << worker_threads << " thread(s)" << std::endl;
+        if (stats.mismatches > 0) {
+            std::cout << stats.mismatches << " of " << stats.digests
+                      << " state digests differ, first at tick " << stats.first_mismatch << std::endl;
+            return 2;
+        }
+        std::cout << "All " << stats.digests << " state digests match" << std::endl;
+        return 0;
     }
     
     // Initialize database
@@ -36,9 +98,45 @@ int main(int argc, char* argv[]) {
     std::cout << "Database initialized successfully" << std::endl;
     
     // Initialize simulation
-    g_simulation = std::make_shared<Simulation>(db);
+    g_simulation = std::make_shared<Simulation>(db, worker_threads, seed);
+    g_simulation->setEngine(engine);
+    
+    if (!journal_path.empty() && !g_simulation->enableJournal(journal_path)) {
+        return 1;
+    }
+    
+    // Headless runs start from the database state unless a checkpoint is named
+    if (checkpoint_path.empty() && headless_seconds <= 0.0) {
+        checkpoint_path = "transport.ckpt";
+    }
+    if (checkpoints && !checkpoint_path.empty()) {
+        // A journal replays from the database state, so it cannot start from a checkpoint
+        if (journal_path.empty()) {
+            g_simulation->restoreCheckpoint(checkpoint_path);
+        }
+        g_simulation->enableCheckpoints(checkpoint_path, std::chrono::seconds(checkpoint_every));
+    }
+    
+    if (headless_seconds > 0.0) {
+        std::cout << "Running headless for " << headless_seconds << " sim seconds ("
+                  << simulationEngineName(engine) << " engine, ";
+        if (time_scale > 0.0) {
+            std::cout << time_scale << "x";
+        } else {
+            std::cout << "unpaced";
+        }
+        std::cout << ")" << std::endl;
+        RunStats stats = g_simulation->runFor(headless_seconds, time_scale);
+        std::cout << "Simulated " << stats.sim_seconds << " s in " << stats.wall_seconds
+                  << " s wall (" << stats.ticks << " ticks, "
+                  << stats.simSecondsPerWallSecond() << " sim-s/wall-s)" << std::endl;
+        g_simulation->stop(); // writes the final checkpoint, if enabled
+        return 0;
+    }
+    
     g_simulation->start();
-    std::cout << "Simulation started" << std::endl;
+    std::cout << "Simulation started with " << g_simulation->workerThreads()
+              << " worker thread(s)" << std::endl;
     
     // Initialize API server
     APIServer server(db, g_simulation);
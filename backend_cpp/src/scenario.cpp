@@ -0,0 +1,79 @@
+#include "scenario.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Queues the scenario's edits on a fork; they are applied before its first tick
+void applyEdits(Simulation& fork, const NetworkData& data, const ScenarioSpec& spec) {
+    for (const auto& vehicle : data.vehicles) {
+        auto factor = spec.speed_factors.find(vehicle.type);
+        if (factor == spec.speed_factors.end()) continue;
+        Vehicle slower = vehicle;
+        slower.avg_speed *= factor->second;
+        fork.upsertVehicle(slower);
+    }
+
+    // Added vehicles take ids above every existing one
+    int next_id = 1;
+    for (const auto& vehicle : data.vehicles) {
+        next_id = std::max(next_id, vehicle.id + 1);
+    }
+    for (const auto& add : spec.add_vehicles) {
+        auto route = std::find_if(data.routes.begin(), data.routes.end(),
+                                  [&add](const Route& r) { return r.id == add.route_id; });
+        std::string route_name = route != data.routes.end() ? route->name : "";
+        for (int k = 0; k < add.count; ++k) {
+            fork.upsertVehicle({next_id++, add.route_id, add.type, add.avg_speed, route_name});
+        }
+    }
+
+    for (int id : spec.remove_vehicles) {
+        fork.removeVehicle(id);
+    }
+}
+
+} // namespace
+
+ScenarioRunner::ScenarioRunner(size_t threads) : pool_(std::max<size_t>(1, threads)) {
+}
+
+ScenarioReport ScenarioRunner::run(Simulation& live, const NetworkData& data,
+                                   const std::vector<ScenarioSpec>& scenarios, double sim_seconds) {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    auto wall_start = std::chrono::steady_clock::now();
+
+    // One fork of the live state, then one fork of that per scenario: the
+    // live simulation is locked once, and all runs start from the same tick
+    std::vector<std::unique_ptr<Simulation>> forks;
+    forks.push_back(live.fork());
+    Simulation& baseline = *forks.front();
+    for (const auto& spec : scenarios) {
+        forks.push_back(baseline.fork());
+        applyEdits(*forks.back(), data, spec);
+    }
+    auto start = baseline.getLiveSnapshot();
+
+    ScenarioReport report;
+    report.tick = start->tick;
+    report.sim_time = start->sim_time;
+    report.sim_seconds = sim_seconds;
+    report.results.resize(forks.size());
+    pool_.parallelFor(forks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            Simulation& fork = *forks[s];
+            fork.trackService();
+            RunStats stats = fork.runFor(sim_seconds);
+
+            ScenarioResult& result = report.results[s];
+            result.name = s == 0 ? "baseline" : scenarios[s - 1].name;
+            result.vehicles = fork.getLiveSnapshot()->positions.size();
+            result.total = fork.serviceTotal();
+            result.routes = fork.serviceByRoute();
+            result.wall_seconds = stats.wall_seconds;
+        }
+    });
+
+    report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    return report;
+}
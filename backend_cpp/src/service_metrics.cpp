@@ -0,0 +1,74 @@
+#include "service_metrics.h"
+
+void ServiceMetrics::observe(size_t group, const VehicleStore& store, const Topology& topology, double now) {
+    if (group >= last_stop_.size()) {
+        last_stop_.resize(group + 1);
+    }
+    std::vector<int>& last_stop = last_stop_[group];
+    if (last_stop.size() != store.size()) {
+        // First tick of this layout: nothing to compare against yet
+        last_stop = store.stop_idx;
+        return;
+    }
+    if (routes_.size() < topology.routeCount()) {
+        routes_.resize(topology.routeCount());
+    }
+
+    for (size_t i = 0; i < store.size(); ++i) {
+        int stop = store.stop_idx[i];
+        if (stop == last_stop[i]) continue;
+        last_stop[i] = stop;
+
+        RouteState& route = routes_[store.route_index[i]];
+        size_t key = static_cast<size_t>(stop) * 2 + store.forward[i];
+        if (key >= route.last_arrival.size()) {
+            route.last_arrival.resize(key + 1, -1.0);
+        }
+        ++route.arrivals;
+        double& last_arrival = route.last_arrival[key];
+        if (last_arrival >= 0.0) {
+            double headway = now - last_arrival;
+            ++route.headways;
+            route.headway_sum += headway;
+            route.headway_squares += headway * headway;
+        }
+        last_arrival = now;
+    }
+}
+
+void ServiceMetrics::summarize(const RouteState& state, RouteService& service) {
+    service.arrivals = state.arrivals;
+    service.headways = state.headways;
+    if (state.headways > 0 && state.headway_sum > 0.0) {
+        service.average_headway = state.headway_sum / state.headways;
+        service.average_wait = state.headway_squares / (2.0 * state.headway_sum);
+    }
+}
+
+std::vector<RouteService> ServiceMetrics::routes(const Topology& topology) const {
+    std::vector<RouteService> result;
+    for (size_t r = 0; r < routes_.size() && r < topology.routeCount(); ++r) {
+        if (routes_[r].arrivals == 0) continue;
+        const auto& route = topology.route(static_cast<int>(r));
+        RouteService service;
+        service.route_id = route.route_id;
+        service.route_name = route.name;
+        summarize(routes_[r], service);
+        result.push_back(service);
+    }
+    return result;
+}
+
+RouteService ServiceMetrics::total() const {
+    RouteState all;
+    for (const auto& route : routes_) {
+        all.arrivals += route.arrivals;
+        all.headways += route.headways;
+        all.headway_sum += route.headway_sum;
+        all.headway_squares += route.headway_squares;
+    }
+    RouteService service;
+    service.route_id = 0;
+    summarize(all, service);
+    return service;
+}
@@ -1,10 +1,97 @@
 #include "simulation.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
-Simulation::Simulation(std::shared_ptr<Database> db) 
-    : db_(db), running_(false), paused_(true) { // Починаємо з ПАУЗИ (paused_ = true)
-    initializeVehicles();
+namespace {
+
+const double kTickSeconds = 0.1; // simulated time per step
+const auto kTickPeriod = std::chrono::milliseconds(100); // wall time per live tick
+
+// Shards are rebalanced once the largest holds this many vehicles more
+// than a fair share (or a quarter of it, if that is more)
+const size_t kRebalanceSlack = 64;
+
+// Snapshots whose change sets are kept for delta readers (~6s of live updates)
+const size_t kChangeHistory = 64;
+
+// Live periods between snapshots in event mode. Positions only exist
+// analytically there, and materializing the whole fleet every period would
+// cost as much as integrating it, which the event core exists to avoid.
+// Admin changes are still published at once.
+const unsigned kEventPublishPeriods = 5;
+
+// Ticks between state digests in the journal (one simulated minute)
+const uint64_t kDigestTicks = 600;
+
+bool sameBounds(const Bounds& a, const Bounds& b) {
+    return a.min_x == b.min_x && a.min_y == b.min_y && a.max_x == b.max_x && a.max_y == b.max_y;
+}
+
+// Every published field, so renames and retypes reach delta readers too
+bool samePosition(const VehiclePosition& a, const VehiclePosition& b) {
+    return a.vehicle_id == b.vehicle_id && a.x == b.x && a.y == b.y &&
+           a.current_stop_index == b.current_stop_index && a.next_stop_index == b.next_stop_index &&
+           a.route_name == b.route_name && a.type == b.type && a.progress == b.progress;
+}
+
+struct ShardPiece {
+    int shard;
+    size_t vehicles;
+};
+
+// Longest-processing-time-first assignment of routes to shards by vehicle
+// count. A route with more than a fair share of the fleet is cut into
+// pieces of at most that share first, so one busy route cannot hold up the
+// tick. Returns the pieces of each route, in the order its vehicles fill them.
+std::vector<std::vector<ShardPiece>> planShards(const std::vector<size_t>& route_vehicles,
+                                                size_t shard_count) {
+    size_t total = 0;
+    for (size_t count : route_vehicles) {
+        total += count;
+    }
+    const size_t fair_share = std::max<size_t>(1, (total + shard_count - 1) / shard_count);
+    
+    struct Piece {
+        size_t vehicles;
+        int route;
+    };
+    std::vector<Piece> pieces;
+    for (size_t route = 0; route < route_vehicles.size(); ++route) {
+        for (size_t left = route_vehicles[route]; left > 0;) {
+            size_t take = std::min(left, fair_share);
+            pieces.push_back({take, static_cast<int>(route)});
+            left -= take;
+        }
+    }
+    // Largest first; ties keep route order so the plan is deterministic
+    std::stable_sort(pieces.begin(), pieces.end(),
+                     [](const Piece& a, const Piece& b) { return a.vehicles > b.vehicles; });
+    
+    std::vector<size_t> load(shard_count, 0);
+    std::vector<std::vector<ShardPiece>> plan(route_vehicles.size());
+    for (const Piece& piece : pieces) {
+        int shard = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        load[shard] += piece.vehicles;
+        plan[piece.route].push_back({shard, piece.vehicles});
+    }
+    return plan;
+}
+
+} // namespace
+
+Simulation::Simulation(std::shared_ptr<Database> db, size_t worker_threads, uint64_t seed) 
+    : db_(db), running_(false), paused_(true), workers_(worker_threads),
+      engine_(SimulationEngine::FixedTick), time_scale_(1.0), scheduler_(kTickPeriod),
+      seed_(seed) { // Починаємо з ПАУЗИ (paused_ = true)
+    initializeVehicles(db_->getNetworkData());
+}
+
+Simulation::Simulation(const NetworkData& data, size_t worker_threads, uint64_t seed)
+    : running_(false), paused_(true), workers_(worker_threads),
+      engine_(SimulationEngine::FixedTick), time_scale_(1.0), scheduler_(kTickPeriod),
+      seed_(seed) {
+    initializeVehicles(data);
 }
 
 Simulation::~Simulation() {
@@ -18,189 +105,839 @@ void Simulation::start() {
 }
 
 void Simulation::stop() {
-    if (!running_) return;
-    running_ = false;
-    if (simulation_thread_.joinable()) {
-        simulation_thread_.join();
+    if (running_) {
+        running_ = false;
+        if (simulation_thread_.joinable()) {
+            simulation_thread_.join();
+        }
+    }
+    // The final state survives a restart
+    if (checkpoint()) {
+        checkpoints_->flush();
     }
+    if (journal_) {
+        // Closing digest, so a replay checks the whole run
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (journal_->lastDigestTick() != tick_) {
+            record(StateDigest{stateDigest()});
+        }
+    }
+}
+
+void Simulation::pause() {
+    paused_ = true;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    record(SetPaused{true});
+}
+
+void Simulation::resume() {
+    paused_ = false;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    record(SetPaused{false});
 }
 
 bool Simulation::isRunning() const {
     return running_;
 }
 
-void Simulation::initializeVehicles() {
-    auto vehicles = db_->getAllVehicles();
-    std::lock_guard<std::mutex> lock(positions_mutex_);
+template <typename Fn>
+void Simulation::forEachShard(Fn fn) {
+    // Chunks of one shard: worker w starts on shard w, so with as many
+    // shards as workers a shard stays on the same thread unless another
+    // worker runs dry and steals it
+    workers_.parallelFor(shards_.size(), 1, [this, &fn](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            fn(shards_[s]);
+        }
+    });
+}
+
+void Simulation::initializeVehicles(const NetworkData& data) {
+    auto topology = Topology::build(data.stops, data.routes);
+    auto types = VehicleTypes::build(data.vehicle_types);
+    std::lock_guard<std::mutex> lock(state_mutex_);
     
-    vehicle_states_.clear();
+    topology_ = topology;
+    vehicle_types_ = types;
+    shards_ = std::vector<SimulationShard>(workers_.size());
     
-    for (const auto& vehicle : vehicles) {
-        auto route = db_->getRouteById(vehicle.route_id);
-        if (route.stop_ids.empty()) continue;
+    // Everything goes into the first shard, then rebalancing spreads it out
+    VehicleStore& staging = shards_[0].vehicles;
+    staging.setVehicleTypes(types);
+    staging.setSeed(seed_);
+    staging.reserve(data.vehicles.size());
+    for (const auto& vehicle : data.vehicles) {
+        int route_index = topology_->routeIndex(vehicle.route_id);
+        if (route_index < 0) continue;
+        if (topology_->route(route_index).stop_indices.empty()) continue;
         
-        VehicleState state;
-        state.vehicle_id = vehicle.id;
-        state.route_id = vehicle.route_id;
-        state.stop_ids = route.stop_ids;
-        state.current_stop_idx = 0;
-        state.speed = vehicle.avg_speed;
-        state.forward = true;
-        state.dwell_time = 0.0;
-        state.progress = 0.0;
-   
-        if (vehicle.type == "tram") {
-            state.model = std::make_shared<TramModel>();
-        } else if (vehicle.type == "trolleybus") {
-            state.model = std::make_shared<TrolleybusModel>();
-        } else {
-            state.model = std::make_shared<BusModel>();
+        VehicleInfo info{intern(vehicle.route_name), intern(vehicle.type)};
+        staging.add(vehicle.id, route_index, *topology_, vehicle.avg_speed,
+                    types->kindOf(vehicle.type), info);
+    }
+    
+    rebalanceShards();
+    
+    if (engine_ == SimulationEngine::EventDriven) {
+        for (auto& shard : shards_) {
+            shard.events.reset(shard.vehicles, sim_time_);
+        }
+    }
+    publishSnapshot();
+}
+
+void Simulation::rebalanceShards() {
+    std::vector<size_t> route_vehicles(topology_->routeCount(), 0);
+    for (const auto& shard : shards_) {
+        for (int route : shard.vehicles.route_index) {
+            ++route_vehicles[route];
+        }
+    }
+    auto plan = planShards(route_vehicles, shards_.size());
+    
+    std::vector<SimulationShard> shards(shards_.size());
+    for (size_t s = 0; s < shards.size(); ++s) {
+        shards[s].vehicles.setVehicleTypes(vehicle_types_);
+        shards[s].vehicles.setSeed(seed_);
+    }
+    for (size_t route = 0; route < plan.size(); ++route) {
+        for (const ShardPiece& piece : plan[route]) {
+            shards[piece.shard].vehicles.reserve(shards[piece.shard].vehicles.size() + piece.vehicles);
+        }
+    }
+    
+    // Deal each route's vehicles into its pieces, in the current slot order
+    std::vector<size_t> piece(plan.size(), 0);
+    std::vector<size_t> filled(plan.size(), 0);
+    for (const auto& shard : shards_) {
+        const VehicleStore& from = shard.vehicles;
+        for (size_t i = 0; i < from.size(); ++i) {
+            int route = from.route_index[i];
+            const ShardPiece& target = plan[route][piece[route]];
+            shards[target.shard].vehicles.append(from, i);
+            if (++filled[route] == target.vehicles) {
+                ++piece[route];
+                filled[route] = 0;
+            }
+        }
+    }
+    shards_ = std::move(shards);
+    
+    route_shards_.assign(plan.size(), {});
+    for (size_t route = 0; route < plan.size(); ++route) {
+        for (const ShardPiece& target : plan[route]) {
+            route_shards_[route].push_back(target.shard);
+        }
+    }
+    rebuildSnapshotIndex();
+}
+
+bool Simulation::shardsUnbalanced() const {
+    size_t total = 0;
+    size_t largest = 0;
+    for (const auto& shard : shards_) {
+        total += shard.vehicles.size();
+        largest = std::max(largest, shard.vehicles.size());
+    }
+    size_t fair_share = (total + shards_.size() - 1) / shards_.size();
+    return largest > fair_share + std::max(kRebalanceSlack, fair_share / 4);
+}
+
+int Simulation::shardFor(int route) {
+    if (static_cast<size_t>(route) >= route_shards_.size()) {
+        route_shards_.resize(route + 1);
+    }
+    auto smaller = [this](int a, int b) { return shards_[a].vehicles.size() < shards_[b].vehicles.size(); };
+    auto& hosts = route_shards_[route];
+    if (!hosts.empty()) {
+        return *std::min_element(hosts.begin(), hosts.end(), smaller);
+    }
+    
+    // First vehicle of the route: the least loaded shard takes it
+    int shard = 0;
+    for (int s = 1; s < static_cast<int>(shards_.size()); ++s) {
+        if (smaller(s, shard)) shard = s;
+    }
+    hosts.push_back(shard);
+    return shard;
+}
+
+bool Simulation::locate(int vehicle_id, int& shard, int& slot) const {
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        slot = shards_[s].vehicles.slotOf(vehicle_id);
+        if (slot >= 0) {
+            shard = static_cast<int>(s);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<size_t> Simulation::shardSizes() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    std::vector<size_t> sizes;
+    for (const auto& shard : shards_) {
+        sizes.push_back(shard.vehicles.size());
+    }
+    return sizes;
+}
+
+void Simulation::rebuildSnapshotIndex() {
+    // A new index marks a new fleet layout: delta readers resync.
+    // Positions are laid out shard after shard.
+    auto index = std::make_shared<std::unordered_map<int, size_t>>();
+    size_t offset = 0;
+    for (auto& shard : shards_) {
+        shard.offset = offset;
+        offset += shard.vehicles.size();
+    }
+    index->reserve(offset);
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < shard.vehicles.size(); ++i) {
+            (*index)[shard.vehicles.vehicle_id[i]] = shard.offset + i;
         }
+    }
+    snapshot_index_ = index;
+}
+
+bool Simulation::restoreCheckpoint(const std::string& path) {
+    Checkpoint saved;
+    if (!Checkpoint::read(path, saved)) return false;
     
-        // Start at first stop
-        auto coords = getStopCoordinates(state.stop_ids[0]);
-        state.x = coords.first;
-        state.y = coords.second;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    size_t restored = 0;
+    for (const auto& vehicle : saved.vehicles) {
+        int shard, slot;
+        if (!locate(vehicle.vehicle_id, shard, slot)) continue;
+        VehicleStore& store = shards_[shard].vehicles;
+        const auto& route = topology_->route(store.route_index[slot]);
+        if (route.route_id != vehicle.route_id) continue;
+        if (vehicle.stop_idx < 0 || vehicle.stop_idx >= static_cast<int>(route.stop_indices.size())) continue;
         
-        // Set target to next stop
-        if (state.stop_ids.size() > 1) {
-            auto next_coords = getStopCoordinates(state.stop_ids[1]);
-            state.target_x = next_coords.first;
-            state.target_y = next_coords.second;
+        store.resume(slot, *topology_, vehicle.stop_idx, vehicle.forward, vehicle.travelled,
+                     vehicle.velocity, vehicle.dwell, vehicle.rng);
+        ++restored;
+    }
+    
+    tick_ = saved.tick;
+    sim_time_ = saved.sim_time;
+    rebuildSnapshotIndex(); // tick numbering restarts from the checkpoint
+    if (engine_ == SimulationEngine::EventDriven) {
+        for (auto& shard : shards_) {
+            shard.events.reset(shard.vehicles, sim_time_);
+        }
+    }
+    publishSnapshot();
+    
+    std::cout << "Restored " << restored << " of " << saved.vehicles.size()
+              << " vehicles from " << path << " (tick " << tick_ << ")" << std::endl;
+    return true;
+}
+
+void Simulation::enableCheckpoints(const std::string& path, std::chrono::seconds interval) {
+    checkpoints_ = std::make_unique<CheckpointWriter>(path);
+    checkpoint_interval_ = interval;
+}
+
+bool Simulation::checkpoint() {
+    if (!checkpoints_) return false;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    submitCheckpoint();
+    return true;
+}
+
+void Simulation::submitCheckpoint() {
+    std::vector<const VehicleStore*> stores;
+    for (auto& shard : shards_) {
+        if (engine_ == SimulationEngine::EventDriven) {
+            // Positions and remaining dwell times only exist analytically
+            shard.events.materialize(shard.vehicles, sim_time_, 0, shard.vehicles.size());
+        }
+        stores.push_back(&shard.vehicles);
+    }
+    checkpoints_->submit(Checkpoint::encode(stores, *topology_, tick_, sim_time_));
+}
+
+void Simulation::upsertStop(const Stop& stop) {
+    enqueue(stop);
+}
+
+void Simulation::upsertRoute(const Route& route) {
+    enqueue(route);
+}
+
+void Simulation::upsertVehicle(const Vehicle& vehicle) {
+    // Interned here so a full symbol table fails the caller, not the tick
+    intern(vehicle.route_name);
+    intern(vehicle.type);
+    enqueue(vehicle);
+}
+
+void Simulation::removeVehicle(int vehicle_id) {
+    enqueue(RemoveVehicle{vehicle_id});
+}
+
+void Simulation::reloadVehicleTypes(const std::vector<VehicleType>& types) {
+    enqueue(SetVehicleTypes{types});
+}
+
+void Simulation::enqueue(DataCommand command) {
+    std::lock_guard<std::mutex> lock(commands_mutex_);
+    pending_commands_.push_back(std::move(command));
+}
+
+bool Simulation::applyPendingCommands() {
+    std::vector<DataCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(commands_mutex_);
+        commands.swap(pending_commands_);
+    }
+    if (commands.empty()) return false;
+    record(DataBatch{commands});
+    
+    auto previous_topology = topology_;
+    bool layout_changed = false;
+    for (const auto& command : commands) {
+        if (const auto* stop = std::get_if<Stop>(&command)) {
+            topology_ = topology_->withStop(*stop);
+        } else if (const auto* route = std::get_if<Route>(&command)) {
+            topology_ = topology_->withRoute(*route);
+        } else if (const auto* vehicle = std::get_if<Vehicle>(&command)) {
+            layout_changed |= applyVehicle(*vehicle);
+        } else if (const auto* remove = std::get_if<RemoveVehicle>(&command)) {
+            int shard, slot;
+            if (locate(remove->vehicle_id, shard, slot)) {
+                layout_changed |= removeFromShard(shards_[shard], remove->vehicle_id);
+            }
+        } else if (const auto* types = std::get_if<SetVehicleTypes>(&command)) {
+            applyVehicleTypes(VehicleTypes::build(types->types));
+        }
+    }
+    
+    // Vehicles on routes whose geometry was replaced follow the new shape
+    if (topology_ != previous_topology) {
+        for (auto& shard : shards_) {
+            VehicleStore& store = shard.vehicles;
+            std::vector<int> stranded; // route lost all its stops
+            for (size_t i = 0; i < store.size(); ++i) {
+                int route = store.route_index[i];
+                if (static_cast<size_t>(route) >= previous_topology->routeCount()) continue; // placed on it just now
+                if (topology_->sharedRoute(route) == previous_topology->sharedRoute(route)) continue;
+                if (topology_->route(route).stop_indices.empty()) {
+                    stranded.push_back(store.vehicle_id[i]);
+                } else {
+                    syncSlot(shard, i);
+                    if (store.retarget(i, *topology_)) {
+                        rescheduleSlot(shard, i);
+                    }
+                }
+            }
+            for (int id : stranded) {
+                layout_changed |= removeFromShard(shard, id);
+            }
+        }
+    }
+    
+    if (layout_changed) {
+        if (!shardsUnbalanced()) {
+            rebuildSnapshotIndex();
+        } else if (engine_ == SimulationEngine::EventDriven) {
+            // Rebalancing moves vehicles between shards, so every queue is
+            // rebuilt from materialized state
+            for (auto& shard : shards_) {
+                shard.events.materialize(shard.vehicles, sim_time_, 0, shard.vehicles.size());
+            }
+            rebalanceShards();
+            for (auto& shard : shards_) {
+                shard.events.reset(shard.vehicles, sim_time_);
+            }
         } else {
-            state.target_x = state.x;
-            state.target_y = state.y;
+            rebalanceShards();
         }
-        
-        vehicle_states_[vehicle.id] = state;
     }
+    if (service_) {
+        // Vehicles moved or placed by the batch have not arrived anywhere
+        service_->forgetSlots();
+    }
+    return true;
 }
 
-std::pair<double, double> Simulation::getStopCoordinates(int stop_id) {
-    auto stop = db_->getStopById(stop_id);
-    return {stop.x, stop.y};
+bool Simulation::applyVehicle(const Vehicle& vehicle) {
+    int route = topology_->routeIndex(vehicle.route_id);
+    bool runnable = route >= 0 && !topology_->route(route).stop_indices.empty();
+    int shard, slot;
+    bool found = locate(vehicle.id, shard, slot);
+    if (!runnable) {
+        return found && removeFromShard(shards_[shard], vehicle.id);
+    }
+    
+    VehicleInfo info{intern(vehicle.route_name), intern(vehicle.type)};
+    VehicleKind kind = vehicle_types_->kindOf(vehicle.type);
+    if (!found) {
+        SimulationShard& target = shards_[shardFor(route)];
+        size_t added = target.vehicles.add(vehicle.id, route, *topology_, vehicle.avg_speed, kind, info);
+        rescheduleSlot(target, added);
+        return true;
+    }
+    
+    SimulationShard& from = shards_[shard];
+    VehicleStore& store = from.vehicles;
+    syncSlot(from, slot);
+    store.update(slot, vehicle.avg_speed, kind, info);
+    if (store.route_index[slot] == route) {
+        rescheduleSlot(from, slot);
+        return false;
+    }
+    
+    int target = shardFor(route);
+    if (target == shard) {
+        store.setRoute(slot, route, *topology_);
+        rescheduleSlot(from, slot);
+        return false;
+    }
+    // Follow the new route to a shard that holds it
+    SimulationShard& to = shards_[target];
+    size_t moved = to.vehicles.append(store, slot);
+    removeFromShard(from, vehicle.id);
+    to.vehicles.setRoute(moved, route, *topology_);
+    rescheduleSlot(to, moved);
+    return true;
 }
 
-void Simulation::simulationLoop() {
-    const double delta_time = 0.1; // 100ms per tick
-    const double dwell_time_at_stop = 5.0; // seconds
+void Simulation::applyVehicleTypes(std::shared_ptr<const VehicleTypes> types) {
+    auto previous = vehicle_types_;
+    vehicle_types_ = types;
+    for (auto& shard : shards_) {
+        VehicleStore& store = shard.vehicles;
+        store.setVehicleTypes(types);
+        for (size_t i = 0; i < store.size(); ++i) {
+            // Resolved by name like initializeVehicles() does: a renamed type
+            // leaves its vehicles on whatever their name now maps to
+            VehicleKind kind = types->kindOf(symbolName(store.info[i].type));
+            const VehicleTypeParams& before = (*previous)[store.kind[i]];
+            const VehicleTypeParams& after = (*types)[kind];
+            if (kind == store.kind[i] && before.speed_factor == after.speed_factor &&
+                before.acceleration == after.acceleration) {
+                continue;
+            }
+            syncSlot(shard, i);
+            store.update(i, store.base_speed[i], kind, store.info[i]);
+            rescheduleSlot(shard, i);
+        }
+    }
+}
+
+void Simulation::syncSlot(SimulationShard& shard, size_t slot) {
+    if (engine_ == SimulationEngine::EventDriven) {
+        shard.events.materialize(shard.vehicles, sim_time_, slot, slot + 1);
+    }
+}
+
+void Simulation::rescheduleSlot(SimulationShard& shard, size_t slot) {
+    if (engine_ == SimulationEngine::EventDriven) {
+        shard.events.refresh(shard.vehicles, slot, sim_time_);
+    }
+}
+
+bool Simulation::removeFromShard(SimulationShard& shard, int vehicle_id) {
+    int slot = shard.vehicles.slotOf(vehicle_id);
+    if (slot < 0) return false;
+    if (engine_ == SimulationEngine::EventDriven) {
+        shard.events.removeSlot(slot);
+    }
+    return shard.vehicles.remove(vehicle_id);
+}
+
+void Simulation::setEngine(SimulationEngine engine) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (engine == engine_) return;
+    record(SetEngine{engine});
+    switchEngine(engine);
+}
+
+void Simulation::switchEngine(SimulationEngine engine) {
+    if (engine == engine_) return;
+    for (auto& shard : shards_) {
+        if (engine == SimulationEngine::EventDriven) {
+            shard.events.reset(shard.vehicles, sim_time_);
+        } else {
+            // Hand the analytic state back to the integrator
+            shard.events.materialize(shard.vehicles, sim_time_, 0, shard.vehicles.size());
+        }
+    }
+    engine_ = engine;
+}
+
+void Simulation::step(double delta_time) {
+    sim_time_ += delta_time;
+    ++tick_;
     
-    while (running_) {
+    // Every vehicle is updated from its own state only, so the result does
+    // not depend on how the fleet is split into shards or which worker runs them
+    if (engine_ == SimulationEngine::EventDriven) {
+        // Only arrivals/departures are processed; positions are evaluated
+        // analytically when a snapshot is published
+        forEachShard([this](SimulationShard& shard) {
+            shard.events.advanceTo(shard.vehicles, *topology_, sim_time_);
+        });
+    } else {
+        forEachShard([this, delta_time](SimulationShard& shard) {
+            shard.vehicles.advance(*topology_, delta_time);
+        });
+    }
+    
+    if (service_) {
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            service_->observe(s, shards_[s].vehicles, *topology_, sim_time_);
+        }
+    }
+    
+    if (journal_ && tick_ % kDigestTicks == 0) {
+        record(StateDigest{stateDigest()});
+    }
+}
+
+uint64_t Simulation::stateDigest() {
+    if (engine_ == SimulationEngine::EventDriven) {
+        // Materializing is a pure function of the event state, so doing it
+        // here does not change the run
+        forEachShard([this](SimulationShard& shard) {
+            shard.events.materialize(shard.vehicles, sim_time_, 0, shard.vehicles.size());
+        });
+    }
+    uint64_t digest = 0;
+    for (const auto& shard : shards_) {
+        digest += shard.vehicles.digest();
+    }
+    return digest;
+}
+
+void Simulation::record(const JournalInput& input) {
+    if (journal_) {
+        journal_->record(tick_, input);
+    }
+}
+
+bool Simulation::enableJournal(const std::string& path) {
+    if (!db_) return false;
+    auto data = db_->getNetworkData();
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto journal = std::make_unique<JournalWriter>(path, data, seed_, engine_);
+    if (!journal->isOpen()) return false;
+    journal_ = std::move(journal);
+    return true;
+}
+
+ReplayStats Simulation::replay(const Journal& journal) {
+    using clock = std::chrono::steady_clock;
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto wall_start = clock::now();
+    ReplayStats stats{0, 0, 0, 0, 0, 0.0};
+    
+    switchEngine(journal.engine);
+    for (const auto& entry : journal.entries) {
+        for (; tick_ < entry.tick; ++stats.ticks) {
+            step(kTickSeconds);
+        }
         
-        if (paused_) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (const auto* digest = std::get_if<StateDigest>(&entry.input)) {
+            ++stats.digests;
+            if (stateDigest() != digest->digest && stats.mismatches++ == 0) {
+                stats.first_mismatch = tick_;
+            }
             continue;
         }
-        auto start_time = std::chrono::steady_clock::now();
         
-        {
-            std::lock_guard<std::mutex> lock(positions_mutex_);
+        ++stats.inputs;
+        if (const auto* batch = std::get_if<DataBatch>(&entry.input)) {
+            {
+                std::lock_guard<std::mutex> commands_lock(commands_mutex_);
+                pending_commands_ = batch->commands;
+            }
+            applyPendingCommands();
+        } else if (const auto* engine = std::get_if<SetEngine>(&entry.input)) {
+            switchEngine(engine->engine);
+        }
+        // Pause, speed and catch-up only affect wall-clock pacing
+    }
+    publishSnapshot();
+    
+    stats.wall_seconds = std::chrono::duration<double>(clock::now() - wall_start).count();
+    return stats;
+}
+
+void Simulation::publishSnapshot() {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.vehicles.size();
+    }
+    
+    auto snapshot = std::make_shared<LiveSnapshot>();
+    auto previous = snapshots_.load();
+    snapshot->tick = tick_;
+    snapshot->version = previous ? previous->version + 1 : 0;
+    snapshot->sim_time = sim_time_;
+    snapshot->index = snapshot_index_;
+    snapshot->positions.resize(total);
+    
+    // Deltas are only meaningful against a snapshot of the same fleet layout
+    bool same_layout = previous && previous->index == snapshot_index_;
+    auto changes = std::make_shared<ChangeSet>();
+    changes->from_version = same_layout ? previous->version : snapshot->version;
+    changes->to_version = snapshot->version;
+    
+    // Each shard fills its own range of the merged snapshot and collects its
+    // changed slots; the lists are then joined in shard order, which keeps
+    // them sorted
+    shard_changes_.resize(shards_.size());
+    workers_.parallelFor(shards_.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            SimulationShard& shard = shards_[s];
+            const VehicleStore& vehicles = shard.vehicles;
+            std::vector<uint32_t>& changed = shard_changes_[s];
+            changed.clear();
+            if (engine_ == SimulationEngine::EventDriven) {
+                shard.events.materialize(shard.vehicles, sim_time_, 0, vehicles.size());
+            }
             
-            for (auto& [vehicle_id, state] : vehicle_states_) {
-                updateVehicle(state, delta_time);
-                
-                // Update live positions
-                VehiclePosition pos;
-                pos.vehicle_id = vehicle_id;
-                pos.x = state.x;
-                pos.y = state.y;
-                pos.current_stop_index = state.current_stop_idx;
-                pos.next_stop_index = (state.current_stop_idx + 1) % state.stop_ids.size();
-                pos.progress = state.progress;
+            for (size_t i = 0; i < vehicles.size(); ++i) {
+                int stop_count = static_cast<int>(
+                    topology_->route(vehicles.route_index[i]).stop_indices.size());
+                size_t slot = shard.offset + i;
                 
-                auto vehicle = db_->getVehicleById(vehicle_id);
-                pos.route_name = vehicle.route_name;
-                pos.type = vehicle.type;
+                VehiclePosition& pos = snapshot->positions[slot];
+                pos.vehicle_id = vehicles.vehicle_id[i];
+                pos.x = vehicles.x[i];
+                pos.y = vehicles.y[i];
+                pos.current_stop_index = vehicles.stop_idx[i];
+                pos.next_stop_index = (vehicles.stop_idx[i] + 1) % stop_count;
+                pos.progress = vehicles.progress[i];
+                pos.route_name = vehicles.info[i].route_name;
+                pos.type = vehicles.info[i].type;
                 
-                live_positions_[vehicle_id] = pos;
+                if (same_layout && !samePosition(pos, previous->positions[slot])) {
+                    changed.push_back(static_cast<uint32_t>(slot));
+                }
             }
         }
-        
-        // Sleep to maintain ~10Hz update rate
-        auto end_time = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            end_time - start_time).count();
-        int sleep_ms = std::max(0, 100 - static_cast<int>(elapsed));
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+    });
+    for (const auto& changed : shard_changes_) {
+        changes->slots.insert(changes->slots.end(), changed.begin(), changed.end());
     }
-}
-
-void Simulation::updateVehicle(VehicleState& state, double delta_time) {
-    if (state.dwell_time > 0.0) {
-        state.dwell_time -= delta_time;
-        return;
+    
+    if (same_layout && sameBounds(previous->grid->bounds(), topology_->bounds())) {
+        snapshot->grid = previous->grid->update(previous->positions, snapshot->positions, changes->slots);
+    } else {
+        snapshot->grid = SpatialGrid::build(topology_->bounds(), snapshot->positions);
     }
     
-    // Calculate distance to target
-    double dx = state.target_x - state.x;
-    double dy = state.target_y - state.y;
-    double distance = std::sqrt(dx * dx + dy * dy);
+    if (same_layout) {
+        size_t keep = std::min(previous->history.size(), kChangeHistory - 1);
+        snapshot->history.reserve(keep + 1);
+        snapshot->history.assign(previous->history.end() - keep, previous->history.end());
+    }
+    snapshot->history.push_back(std::move(changes));
     
-    // Convert speed from km/h to units per second (assuming 1 unit = 100m)
-    double speed_units_per_sec = (state.speed / 3.6) / 0.1; // km/h -> m/s -> units/s
+    snapshots_.publish(std::move(snapshot));
+}
+
+void Simulation::simulationLoop() {
+    double owed_steps = 0.0; // fractional steps carried between ticks at odd time scales
+    unsigned periods = 1;    // wall periods the next tick covers (> 1 when catching up)
+    unsigned unpublished = 0; // periods stepped since the last snapshot
+    auto next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval_;
+    scheduler_.reset();
     
-    if (distance < 0.5) { // Reached stop (within 0.5 units)
-        // Arrived at stop
-        state.x = state.target_x;
-        state.y = state.target_y;
-        state.progress = 0.0;
-        state.dwell_time = state.model->getDwellTime(); // Use model's dwell time
+    while (running_) {
         
-        // Move to next stop
-        if (state.forward) {
-            state.current_stop_idx++;
-            if (state.current_stop_idx >= static_cast<int>(state.stop_ids.size())) {
-                // Loop back to start
-                state.current_stop_idx = 0;
-            }
-        } else {
-            state.current_stop_idx--;
-            if (state.current_stop_idx < 0) {
-                state.current_stop_idx = state.stop_ids.size() - 1;
+        if (paused_ || headless_) {
+            {
+                // Admin changes still show up while paused
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                if (applyPendingCommands() || unpublished > 0) {
+                    publishSnapshot();
+                    unpublished = 0;
+                }
             }
+            std::this_thread::sleep_for(kTickPeriod);
+            // Time spent paused is neither simulated nor counted as overrun
+            scheduler_.reset();
+            periods = 1;
+            continue;
         }
         
-        // Set next target
-        int next_idx = state.forward 
-            ? ((state.current_stop_idx + 1) % state.stop_ids.size())
-            : ((state.current_stop_idx - 1 + state.stop_ids.size()) % state.stop_ids.size());
+        owed_steps += time_scale_ * periods;
+        auto steps = static_cast<uint64_t>(owed_steps);
+        owed_steps -= static_cast<double>(steps);
         
-        auto next_coords = getStopCoordinates(state.stop_ids[next_idx]);
-        state.target_x = next_coords.first;
-        state.target_y = next_coords.second;
-    } else {
-        // Move towards target
-        double move_distance = speed_units_per_sec * delta_time;
-        double ratio = std::min(1.0, move_distance / distance);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            bool changed = applyPendingCommands();
+            for (uint64_t i = 0; i < steps; ++i) {
+                step(kTickSeconds);
+            }
+            if (steps > 0) {
+                ++unpublished;
+            }
+            unsigned publish_every = engine_ == SimulationEngine::EventDriven ? kEventPublishPeriods : 1;
+            if (changed || unpublished >= publish_every) {
+                publishSnapshot();
+                unpublished = 0;
+            }
+            // Only the encode runs here; the file is written off this thread
+            if (checkpoints_ && std::chrono::steady_clock::now() >= next_checkpoint) {
+                submitCheckpoint();
+                next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval_;
+            }
+        }
+        
+        // Sleep until the next 10Hz deadline
+        periods = scheduler_.waitNext();
+    }
+}
+
+void Simulation::setCatchUp(CatchUpPolicy policy, unsigned max_catch_up) {
+    scheduler_.setPolicy(policy, max_catch_up);
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    record(SetCatchUp{policy, max_catch_up});
+}
+
+void Simulation::setTimeScale(double scale) {
+    time_scale_ = std::max(0.0, scale);
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    record(SetTimeScale{time_scale_});
+}
+
+RunStats Simulation::runFor(double sim_seconds, double time_scale) {
+    using clock = std::chrono::steady_clock;
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    headless_ = true;
+    
+    // NaN and negative spans run nothing; the cap keeps the tick count in range
+    double ticks = sim_seconds > 0.0 ? std::min(sim_seconds / kTickSeconds, 1e15) : 0.0;
+    const auto total = static_cast<uint64_t>(std::llround(ticks));
+    uint64_t done = 0;
+    double owed_steps = 0.0;
+    auto wall_start = clock::now();
+    auto deadline = wall_start + kTickPeriod;
+    
+    while (done < total) {
+        uint64_t batch = total - done;
+        if (time_scale > 0.0) {
+            owed_steps += time_scale;
+            batch = std::min<uint64_t>(batch, static_cast<uint64_t>(owed_steps));
+            owed_steps -= static_cast<double>(batch);
+        }
         
-        state.x += dx * ratio;
-        state.y += dy * ratio;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            applyPendingCommands();
+            for (uint64_t i = 0; i < batch; ++i) {
+                step(kTickSeconds);
+                ++done;
+                // Unpaced: surface for a publish once per wall period
+                if (time_scale <= 0.0 && (done & 0xff) == 0 && clock::now() >= deadline) {
+                    break;
+                }
+            }
+            publishSnapshot();
+        }
         
-        // Update progress (0.0 to 1.0)
-        double total_distance = std::sqrt(
-            std::pow(state.target_x - getStopCoordinates(state.stop_ids[state.current_stop_idx]).first, 2) +
-            std::pow(state.target_y - getStopCoordinates(state.stop_ids[state.current_stop_idx]).second, 2)
-        );
-        double traveled = total_distance - distance;
-        state.progress = std::min(1.0, std::max(0.0, traveled / total_distance));
+        if (time_scale > 0.0) {
+            std::this_thread::sleep_until(deadline);
+        }
+        deadline += kTickPeriod;
     }
+    
+    headless_ = false;
+    
+    RunStats stats;
+    stats.ticks = done;
+    stats.sim_seconds = done * kTickSeconds;
+    stats.wall_seconds = std::chrono::duration<double>(clock::now() - wall_start).count();
+    return stats;
 }
 
-std::vector<VehiclePosition> Simulation::getLivePositions() {
-    std::lock_guard<std::mutex> lock(positions_mutex_);
-    std::vector<VehiclePosition> positions;
-    for (const auto& [vehicle_id, pos] : live_positions_) {
-        positions.push_back(pos);
+std::unique_ptr<Simulation> Simulation::fork() {
+    auto copy = std::make_unique<Simulation>(NetworkData{}, 1, seed_);
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    copy->topology_ = topology_;
+    copy->vehicle_types_ = vehicle_types_;
+    // Shards are copied as they are, event queues included, so an unchanged
+    // fork continues exactly like this simulation; one worker runs them all
+    copy->shards_ = shards_;
+    copy->route_shards_ = route_shards_;
+    copy->tick_ = tick_;
+    copy->sim_time_ = sim_time_;
+    copy->engine_ = engine_.load();
+    copy->rebuildSnapshotIndex();
+    copy->publishSnapshot();
+    return copy;
+}
+
+void Simulation::trackService() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    service_ = std::make_unique<ServiceMetrics>();
+}
+
+std::vector<RouteService> Simulation::serviceByRoute() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return service_ ? service_->routes(*topology_) : std::vector<RouteService>();
+}
+
+RouteService Simulation::serviceTotal() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return service_ ? service_->total() : RouteService{};
+}
+
+const VehiclePosition* LiveSnapshot::find(int vehicle_id) const {
+    auto it = index->find(vehicle_id);
+    return it != index->end() ? &positions[it->second] : nullptr;
+}
+
+bool LiveSnapshot::changedSince(uint64_t since, std::vector<uint32_t>& slots) const {
+    slots.clear();
+    if (since == version) return true;
+    if (since > version || history.empty() || since < history.front()->from_version) {
+        return false;
+    }
+    
+    for (const auto& changes : history) {
+        if (changes->to_version > since) {
+            slots.insert(slots.end(), changes->slots.begin(), changes->slots.end());
+        }
     }
-    return positions;
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    return true;
 }
 
-VehiclePosition Simulation::getVehiclePosition(int vehicle_id) {
-    std::lock_guard<std::mutex> lock(positions_mutex_);
-    auto it = live_positions_.find(vehicle_id);
-    if (it != live_positions_.end()) {
-        return it->second;
+std::vector<VehiclePosition> LiveSnapshot::inBox(const Bounds& box) const {
+    std::vector<uint32_t> slots;
+    grid->query(box, positions, slots);
+    
+    std::vector<VehiclePosition> result;
+    result.reserve(slots.size());
+    for (uint32_t slot : slots) {
+        result.push_back(positions[slot]);
     }
-    return VehiclePosition{0, 0.0, 0.0, 0, 0, "", "", 0.0};
+    return result;
 }
 
+std::vector<VehiclePosition> Simulation::getLivePositions() {
+    return getLiveSnapshot()->positions;
+}
+
+std::vector<VehiclePosition> Simulation::getLivePositionsInBox(double min_x, double min_y,
+                                                               double max_x, double max_y) {
+    return getLiveSnapshot()->inBox({min_x, min_y, max_x, max_y});
+}
+
+VehiclePosition Simulation::getVehiclePosition(int vehicle_id) {
+    auto snapshot = getLiveSnapshot();
+    if (const VehiclePosition* pos = snapshot->find(vehicle_id)) {
+        return *pos;
+    }
+    return VehiclePosition{0, 0.0, 0.0, 0, 0, 0, 0, 0.0};
+}
@@ -0,0 +1,123 @@
+#include "spatial_grid.h"
+#include "simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+// Cells along the longer side of the network
+const double kCellsPerSide = 64.0;
+
+// Index of a cell along one axis; NaN maps to the first cell and anything
+// past either edge (infinities included) to the nearest one
+size_t clampIndex(double index, size_t count) {
+    if (!(index > 0.0)) return 0;
+    if (!(index < static_cast<double>(count - 1))) return count - 1;
+    return static_cast<size_t>(index);
+}
+
+} // namespace
+
+std::shared_ptr<const SpatialGrid> SpatialGrid::build(const Bounds& bounds,
+                                                      const std::vector<VehiclePosition>& positions) {
+    std::shared_ptr<SpatialGrid> grid(new SpatialGrid());
+    grid->bounds_ = bounds;
+
+    double width = bounds.max_x - bounds.min_x;
+    double height = bounds.max_y - bounds.min_y;
+    double cell_size = std::max(width, height) / kCellsPerSide;
+    if (cell_size > 0.0) {
+        grid->inv_cell_size_ = 1.0 / cell_size;
+        grid->columns_ = static_cast<size_t>(width * grid->inv_cell_size_) + 1;
+        grid->rows_ = static_cast<size_t>(height * grid->inv_cell_size_) + 1;
+    }
+
+    std::vector<Cell> cells(grid->columns_ * grid->rows_);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        cells[grid->cellOf(positions[i])].push_back(static_cast<uint32_t>(i));
+    }
+
+    grid->cells_.resize(cells.size());
+    for (size_t c = 0; c < cells.size(); ++c) {
+        if (!cells[c].empty()) {
+            grid->cells_[c] = std::make_shared<const Cell>(std::move(cells[c]));
+        }
+    }
+    return grid;
+}
+
+std::shared_ptr<const SpatialGrid> SpatialGrid::update(const std::vector<VehiclePosition>& before,
+                                                       const std::vector<VehiclePosition>& after,
+                                                       const std::vector<uint32_t>& changed) const {
+    std::shared_ptr<SpatialGrid> grid(new SpatialGrid(*this));
+
+    // Cells that gained or lost a vehicle get a private copy, once
+    std::unordered_map<size_t, std::shared_ptr<Cell>> copies;
+    auto writable = [&](size_t c) -> Cell& {
+        auto& copy = copies[c];
+        if (!copy) {
+            copy = cells_[c] ? std::make_shared<Cell>(*cells_[c]) : std::make_shared<Cell>();
+        }
+        return *copy;
+    };
+
+    for (uint32_t slot : changed) {
+        size_t from = cellOf(before[slot]);
+        size_t to = cellOf(after[slot]);
+        if (from == to) continue;
+
+        Cell& source = writable(from);
+        auto it = std::find(source.begin(), source.end(), slot);
+        if (it != source.end()) {
+            *it = source.back(); // order within a cell does not matter
+            source.pop_back();
+        }
+        writable(to).push_back(slot);
+    }
+
+    for (auto& [c, copy] : copies) {
+        if (copy->empty()) {
+            grid->cells_[c].reset();
+        } else {
+            grid->cells_[c] = std::move(copy);
+        }
+    }
+    return grid;
+}
+
+void SpatialGrid::query(const Bounds& box, const std::vector<VehiclePosition>& positions,
+                        std::vector<uint32_t>& slots) const {
+    if (box.max_x < box.min_x || box.max_y < box.min_y) return;
+
+    size_t first_column = column(box.min_x);
+    size_t last_column = column(box.max_x);
+    size_t first_row = row(box.min_y);
+    size_t last_row = row(box.max_y);
+
+    for (size_t r = first_row; r <= last_row; ++r) {
+        for (size_t c = first_column; c <= last_column; ++c) {
+            const auto& cell = cells_[r * columns_ + c];
+            if (!cell) continue;
+            for (uint32_t slot : *cell) {
+                const VehiclePosition& pos = positions[slot];
+                if (pos.x >= box.min_x && pos.x <= box.max_x &&
+                    pos.y >= box.min_y && pos.y <= box.max_y) {
+                    slots.push_back(slot);
+                }
+            }
+        }
+    }
+}
+
+size_t SpatialGrid::column(double x) const {
+    return clampIndex(std::floor((x - bounds_.min_x) * inv_cell_size_), columns_);
+}
+
+size_t SpatialGrid::row(double y) const {
+    return clampIndex(std::floor((y - bounds_.min_y) * inv_cell_size_), rows_);
+}
+
+size_t SpatialGrid::cellOf(const VehiclePosition& pos) const {
+    return row(pos.y) * columns_ + column(pos.x);
+}
@@ -0,0 +1,44 @@
+#include "symbol_table.h"
+#include <stdexcept>
+
+SymbolTable& SymbolTable::instance() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::SymbolTable() {
+    intern(""); // Symbol 0
+}
+
+Symbol SymbolTable::intern(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lookup_.find(text);
+    if (it != lookup_.end()) {
+        return it->second;
+    }
+
+    size_t index = size_.load(std::memory_order_relaxed);
+    size_t chunk = index >> kChunkBits;
+    if (chunk >= kMaxChunks) {
+        throw std::length_error("Symbol table is full");
+    }
+    if (!owned_[chunk]) {
+        owned_[chunk] = std::make_unique<Chunk>();
+        chunks_[chunk].store(owned_[chunk].get(), std::memory_order_release);
+    }
+
+    std::string& slot = owned_[chunk]->strings[index & (kChunkSize - 1)];
+    slot.assign(text);
+    Symbol symbol = static_cast<Symbol>(index);
+    lookup_.emplace(slot, symbol); // keyed by the stored copy, which never moves
+    size_.store(index + 1, std::memory_order_release);
+    return symbol;
+}
+
+std::string_view SymbolTable::name(Symbol symbol) const {
+    if (symbol >= size()) {
+        return {};
+    }
+    const Chunk* chunk = chunks_[symbol >> kChunkBits].load(std::memory_order_acquire);
+    return chunk->strings[symbol & (kChunkSize - 1)];
+}
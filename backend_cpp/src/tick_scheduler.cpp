@@ -0,0 +1,81 @@
+#include "tick_scheduler.h"
+#include <algorithm>
+#include <thread>
+
+TickScheduler::TickScheduler(clock::duration period)
+    : period_(period), policy_(CatchUpPolicy::Skip), max_catch_up_(0) {
+    reset();
+}
+
+void TickScheduler::setPolicy(CatchUpPolicy policy, unsigned max_catch_up) {
+    policy_ = policy;
+    max_catch_up_ = max_catch_up;
+}
+
+void TickScheduler::reset() {
+    tick_start_ = clock::now();
+    next_deadline_ = tick_start_;
+}
+
+unsigned TickScheduler::waitNext() {
+    auto now = clock::now();
+    record(now - tick_start_);
+
+    next_deadline_ += period_;
+    if (now < next_deadline_) {
+        std::this_thread::sleep_until(next_deadline_);
+        tick_start_ = clock::now();
+        return 1;
+    }
+
+    // Behind schedule: `missed` deadlines (including this one) have passed.
+    // Realign to the latest of them so the phase of the schedule is kept.
+    late_wakeups_.fetch_add(1, std::memory_order_relaxed);
+    auto missed = static_cast<uint64_t>((now - next_deadline_) / period_) + 1;
+    next_deadline_ += (missed - 1) * period_;
+    tick_start_ = now;
+
+    uint64_t periods = 1;
+    if (policy_ == CatchUpPolicy::CatchUp) {
+        periods = std::min<uint64_t>(missed, 1 + max_catch_up_);
+        caught_up_periods_.fetch_add(periods - 1, std::memory_order_relaxed);
+    }
+    skipped_periods_.fetch_add(missed - periods, std::memory_order_relaxed);
+    return static_cast<unsigned>(periods);
+}
+
+void TickScheduler::record(clock::duration work) {
+    auto us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(work).count());
+
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+    total_tick_us_.fetch_add(us, std::memory_order_relaxed);
+    if (us > max_tick_us_.load(std::memory_order_relaxed)) {
+        max_tick_us_.store(us, std::memory_order_relaxed); // single writer
+    }
+    if (work > period_) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    double ms = us / 1000.0;
+    size_t bucket = std::lower_bound(kTickHistogramBoundsMs.begin(), kTickHistogramBoundsMs.end(), ms) -
+                    kTickHistogramBoundsMs.begin();
+    histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+TickMetrics TickScheduler::metrics() const {
+    TickMetrics m;
+    m.ticks = ticks_.load(std::memory_order_relaxed);
+    m.overruns = overruns_.load(std::memory_order_relaxed);
+    m.late_wakeups = late_wakeups_.load(std::memory_order_relaxed);
+    m.skipped_periods = skipped_periods_.load(std::memory_order_relaxed);
+    m.caught_up_periods = caught_up_periods_.load(std::memory_order_relaxed);
+    m.max_tick_ms = max_tick_us_.load(std::memory_order_relaxed) / 1000.0;
+    m.mean_tick_ms = m.ticks > 0
+        ? total_tick_us_.load(std::memory_order_relaxed) / 1000.0 / m.ticks
+        : 0.0;
+    for (size_t i = 0; i < histogram_.size(); ++i) {
+        m.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+    }
+    return m;
+}
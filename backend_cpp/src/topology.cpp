@@ -0,0 +1,137 @@
+#include "topology.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+Segment makeSegment(const StopPoint& from, const StopPoint& to) {
+    Segment segment{from.x, from.y, to.x, to.y, 0.0, 0.0, 0.0, 0.0};
+    double dx = to.x - from.x;
+    double dy = to.y - from.y;
+    segment.length = std::sqrt(dx * dx + dy * dy);
+    if (segment.length > 0.0) {
+        segment.inv_length = 1.0 / segment.length;
+        segment.dir_x = dx * segment.inv_length;
+        segment.dir_y = dy * segment.inv_length;
+    }
+    return segment;
+}
+
+} // namespace
+
+std::shared_ptr<const Topology> Topology::load(Database& db) {
+    return build(db.getAllStops(), db.getAllRoutes());
+}
+
+std::shared_ptr<const Topology> Topology::build(const std::vector<Stop>& stops,
+                                                const std::vector<Route>& routes) {
+    std::shared_ptr<Topology> topology(new Topology());
+
+    topology->stops_.reserve(stops.size());
+    for (const auto& stop : stops) {
+        topology->stop_index_[stop.id] = static_cast<int>(topology->stops_.size());
+        topology->stops_.push_back({stop.id, stop.x, stop.y});
+    }
+    topology->computeBounds();
+
+    topology->routes_.reserve(routes.size());
+    for (const auto& route : routes) {
+        topology->route_index_[route.id] = static_cast<int>(topology->routes_.size());
+        topology->routes_.push_back(topology->makeRoute(route));
+    }
+
+    return topology;
+}
+
+std::shared_ptr<const Topology> Topology::withStop(const Stop& stop) const {
+    std::shared_ptr<Topology> topology(new Topology(*this));
+
+    int index = stopIndex(stop.id);
+    if (index < 0) {
+        // Not on any route yet
+        topology->stop_index_[stop.id] = static_cast<int>(topology->stops_.size());
+        topology->stops_.push_back({stop.id, stop.x, stop.y});
+    } else {
+        topology->stops_[index] = {stop.id, stop.x, stop.y};
+        for (auto& route : topology->routes_) {
+            const auto& indices = route->stop_indices;
+            if (std::find(indices.begin(), indices.end(), index) == indices.end()) continue;
+
+            auto geometry = std::make_shared<RouteGeometry>(*route);
+            topology->computeSegments(*geometry);
+            route = geometry;
+        }
+    }
+    topology->computeBounds();
+    return topology;
+}
+
+std::shared_ptr<const Topology> Topology::withRoute(const Route& route) const {
+    std::shared_ptr<Topology> topology(new Topology(*this));
+
+    int index = routeIndex(route.id);
+    if (index < 0) {
+        topology->route_index_[route.id] = static_cast<int>(topology->routes_.size());
+        topology->routes_.push_back(makeRoute(route));
+    } else {
+        topology->routes_[index] = makeRoute(route);
+    }
+    return topology;
+}
+
+std::shared_ptr<const RouteGeometry> Topology::makeRoute(const Route& route) const {
+    auto geometry = std::make_shared<RouteGeometry>();
+    geometry->route_id = route.id;
+    geometry->name = route.name;
+    geometry->type = route.type;
+
+    geometry->stop_indices.reserve(route.stop_ids.size());
+    for (int stop_id : route.stop_ids) {
+        int index = stopIndex(stop_id);
+        if (index < 0) {
+            std::cerr << "Route " << route.id << " references unknown stop "
+                      << stop_id << ", skipping it" << std::endl;
+            continue;
+        }
+        geometry->stop_indices.push_back(index);
+    }
+
+    computeSegments(*geometry);
+    return geometry;
+}
+
+void Topology::computeSegments(RouteGeometry& geometry) const {
+    size_t count = geometry.stop_indices.size();
+    geometry.segments.clear();
+    geometry.segments.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& from = stops_[geometry.stop_indices[i]];
+        const auto& to = stops_[geometry.stop_indices[(i + 1) % count]];
+        geometry.segments.push_back(makeSegment(from, to));
+    }
+}
+
+void Topology::computeBounds() {
+    if (stops_.empty()) {
+        bounds_ = {0.0, 0.0, 0.0, 0.0};
+        return;
+    }
+    bounds_ = {stops_[0].x, stops_[0].y, stops_[0].x, stops_[0].y};
+    for (const auto& stop : stops_) {
+        bounds_.min_x = std::min(bounds_.min_x, stop.x);
+        bounds_.min_y = std::min(bounds_.min_y, stop.y);
+        bounds_.max_x = std::max(bounds_.max_x, stop.x);
+        bounds_.max_y = std::max(bounds_.max_y, stop.y);
+    }
+}
+
+int Topology::stopIndex(int stop_id) const {
+    auto it = stop_index_.find(stop_id);
+    return it != stop_index_.end() ? it->second : -1;
+}
+
+int Topology::routeIndex(int route_id) const {
+    auto it = route_index_.find(route_id);
+    return it != route_index_.end() ? it->second : -1;
+}
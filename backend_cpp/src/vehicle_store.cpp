@@ -0,0 +1,340 @@
+#include "vehicle_store.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// splitmix64: cheap, well-mixed and needs one word of state per vehicle
+uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [-1, 1)
+double nextSymmetric(uint64_t& state) {
+    return static_cast<double>(nextRandom(state) >> 11) * 0x1.0p-52 - 1.0;
+}
+
+// Folds the bits of a value into an FNV-1a style hash
+template <typename T>
+void hashValue(uint64_t& hash, const T& value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    hash = (hash ^ bits) * 0x100000001b3ULL;
+}
+
+// Moves the last entry of every column into slot i
+template <typename... Columns>
+void swapRemove(size_t i, Columns&... columns) {
+    ((columns[i] = columns.back(), columns.pop_back()), ...);
+}
+
+} // namespace
+
+void VehicleStore::clear() {
+    vehicle_id.clear();
+    route_index.clear();
+    stop_idx.clear();
+    x.clear();
+    y.clear();
+    start_x.clear();
+    start_y.clear();
+    dir_x.clear();
+    dir_y.clear();
+    length.clear();
+    inv_length.clear();
+    travelled.clear();
+    base_speed.clear();
+    speed.clear();
+    velocity.clear();
+    accel.clear();
+    progress.clear();
+    dwell.clear();
+    forward.clear();
+    kind.clear();
+    rng.clear();
+    info.clear();
+    slot_index_.clear();
+}
+
+void VehicleStore::reserve(size_t count) {
+    vehicle_id.reserve(count);
+    route_index.reserve(count);
+    stop_idx.reserve(count);
+    x.reserve(count);
+    y.reserve(count);
+    start_x.reserve(count);
+    start_y.reserve(count);
+    dir_x.reserve(count);
+    dir_y.reserve(count);
+    length.reserve(count);
+    inv_length.reserve(count);
+    travelled.reserve(count);
+    base_speed.reserve(count);
+    speed.reserve(count);
+    velocity.reserve(count);
+    accel.reserve(count);
+    progress.reserve(count);
+    dwell.reserve(count);
+    forward.reserve(count);
+    kind.reserve(count);
+    rng.reserve(count);
+    info.reserve(count);
+    slot_index_.reserve(count);
+}
+
+size_t VehicleStore::add(int id, int route, const Topology& topology, double avg_speed,
+                         VehicleKind vehicle_kind, VehicleInfo vehicle_info) {
+    const auto& first = topology.stop(topology.route(route).stop_indices[0]);
+
+    size_t slot = size();
+    vehicle_id.push_back(id);
+    route_index.push_back(route);
+    stop_idx.push_back(0);
+    x.push_back(first.x);
+    y.push_back(first.y);
+    start_x.push_back(0.0);
+    start_y.push_back(0.0);
+    dir_x.push_back(0.0);
+    dir_y.push_back(0.0);
+    length.push_back(0.0);
+    inv_length.push_back(0.0);
+    travelled.push_back(0.0);
+    base_speed.push_back(avg_speed);
+    speed.push_back(avg_speed * (*types_)[vehicle_kind].speed_factor);
+    accel.push_back((*types_)[vehicle_kind].acceleration);
+    velocity.push_back(0.0);
+    progress.push_back(0.0);
+    dwell.push_back(0.0);
+    forward.push_back(1);
+    kind.push_back(vehicle_kind);
+    uint64_t stream = seed_;
+    rng.push_back(nextRandom(stream) + static_cast<uint64_t>(id));
+    info.push_back(vehicle_info);
+    slot_index_[id] = slot;
+    velocity[slot] = departureVelocity(slot);
+    enterSegment(slot, topology);
+    return slot;
+}
+
+size_t VehicleStore::append(const VehicleStore& other, size_t i) {
+    size_t slot = size();
+    vehicle_id.push_back(other.vehicle_id[i]);
+    route_index.push_back(other.route_index[i]);
+    stop_idx.push_back(other.stop_idx[i]);
+    x.push_back(other.x[i]);
+    y.push_back(other.y[i]);
+    start_x.push_back(other.start_x[i]);
+    start_y.push_back(other.start_y[i]);
+    dir_x.push_back(other.dir_x[i]);
+    dir_y.push_back(other.dir_y[i]);
+    length.push_back(other.length[i]);
+    inv_length.push_back(other.inv_length[i]);
+    travelled.push_back(other.travelled[i]);
+    base_speed.push_back(other.base_speed[i]);
+    speed.push_back(other.speed[i]);
+    velocity.push_back(other.velocity[i]);
+    accel.push_back(other.accel[i]);
+    progress.push_back(other.progress[i]);
+    dwell.push_back(other.dwell[i]);
+    forward.push_back(other.forward[i]);
+    kind.push_back(other.kind[i]);
+    rng.push_back(other.rng[i]);
+    info.push_back(other.info[i]);
+    slot_index_[other.vehicle_id[i]] = slot;
+    return slot;
+}
+
+int VehicleStore::slotOf(int id) const {
+    auto it = slot_index_.find(id);
+    return it != slot_index_.end() ? static_cast<int>(it->second) : -1;
+}
+
+bool VehicleStore::remove(int id) {
+    int slot = slotOf(id);
+    if (slot < 0) return false;
+
+    size_t last = size() - 1;
+    if (static_cast<size_t>(slot) != last) {
+        slot_index_[vehicle_id[last]] = slot;
+    }
+    slot_index_.erase(id);
+    swapRemove(slot, vehicle_id, route_index, stop_idx, x, y, start_x, start_y, dir_x, dir_y,
+               length, inv_length, travelled, base_speed, speed, velocity, accel, progress, dwell,
+               forward, kind, rng, info);
+    return true;
+}
+
+void VehicleStore::update(size_t i, double avg_speed, VehicleKind vehicle_kind,
+                          VehicleInfo vehicle_info) {
+    const VehicleTypeParams& type = (*types_)[vehicle_kind];
+    base_speed[i] = avg_speed;
+    speed[i] = avg_speed * type.speed_factor;
+    accel[i] = type.acceleration;
+    velocity[i] = std::min(velocity[i], speed[i]);
+    if (accel[i] <= 0.0 && dwell[i] <= 0.0) {
+        velocity[i] = speed[i];
+    }
+    kind[i] = vehicle_kind;
+    info[i] = vehicle_info;
+}
+
+void VehicleStore::setRoute(size_t i, int route, const Topology& topology) {
+    const auto& first = topology.stop(topology.route(route).stop_indices[0]);
+    route_index[i] = route;
+    stop_idx[i] = 0;
+    forward[i] = 1;
+    x[i] = first.x;
+    y[i] = first.y;
+    dwell[i] = 0.0;
+    velocity[i] = departureVelocity(i);
+    enterSegment(i, topology);
+}
+
+bool VehicleStore::retarget(size_t i, const Topology& topology) {
+    const auto& route = topology.route(route_index[i]);
+    const int stop_count = static_cast<int>(route.stop_indices.size());
+
+    if (stop_idx[i] < stop_count) {
+        const int segment_count = static_cast<int>(route.segments.size());
+        const Segment& segment = forward[i]
+            ? route.segments[stop_idx[i]]
+            : route.segments[(stop_idx[i] - 1 + segment_count) % segment_count];
+        double sx = forward[i] ? segment.start_x : segment.end_x;
+        double sy = forward[i] ? segment.start_y : segment.end_y;
+        if (sx == start_x[i] && sy == start_y[i] && segment.length == length[i] &&
+            (forward[i] ? segment.dir_x : -segment.dir_x) == dir_x[i] &&
+            (forward[i] ? segment.dir_y : -segment.dir_y) == dir_y[i]) {
+            return false; // same segment, keep going
+        }
+    } else {
+        stop_idx[i] = 0;
+    }
+
+    const auto& stop = topology.stop(route.stop_indices[stop_idx[i]]);
+    x[i] = stop.x;
+    y[i] = stop.y;
+    if (dwell[i] <= 0.0) {
+        velocity[i] = departureVelocity(i);
+    }
+    enterSegment(i, topology);
+    return true;
+}
+
+void VehicleStore::resume(size_t i, const Topology& topology, int stop, bool forward_dir,
+                          double travelled_dist, double current_velocity, double dwell_left,
+                          uint64_t rng_state) {
+    stop_idx[i] = stop;
+    forward[i] = forward_dir ? 1 : 0;
+    enterSegment(i, topology);
+
+    travelled[i] = std::min(std::max(0.0, travelled_dist), length[i]);
+    progress[i] = travelled[i] * inv_length[i];
+    x[i] = start_x[i] + dir_x[i] * travelled[i];
+    y[i] = start_y[i] + dir_y[i] * travelled[i];
+    velocity[i] = std::min(std::max(0.0, current_velocity), speed[i]);
+    dwell[i] = dwell_left;
+    rng[i] = rng_state;
+}
+
+uint64_t VehicleStore::digest() const {
+    // Sum of per-vehicle hashes, so the slot order and the way vehicles are
+    // split across stores do not matter
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size(); ++i) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        hashValue(hash, vehicle_id[i]);
+        hashValue(hash, route_index[i]);
+        hashValue(hash, stop_idx[i]);
+        hashValue(hash, forward[i]);
+        hashValue(hash, x[i]);
+        hashValue(hash, y[i]);
+        hashValue(hash, travelled[i]);
+        hashValue(hash, velocity[i]);
+        hashValue(hash, dwell[i]);
+        hashValue(hash, rng[i]);
+        sum += nextRandom(hash);
+    }
+    return sum;
+}
+
+void VehicleStore::setSimdLevel(SimdLevel level) {
+    simd_level_ = std::min(level, detectSimdLevel());
+    motion_kernel_ = motionKernel(simd_level_);
+}
+
+void VehicleStore::advance(const Topology& topology, double delta_time, size_t begin, size_t end) {
+    if (begin >= end) return;
+
+    // Arrivals are rare, so the kernel only collects them and they are
+    // resolved here one by one. Thread-local because chunks run in parallel.
+    thread_local std::vector<uint32_t> arrivals;
+    arrivals.resize(end - begin);
+
+    MotionColumns columns{x.data(), y.data(), start_x.data(), start_y.data(),
+                          dir_x.data(), dir_y.data(), length.data(), inv_length.data(),
+                          travelled.data(), speed.data(), velocity.data(), accel.data(),
+                          progress.data(), dwell.data()};
+    size_t arrived = motion_kernel_(columns, begin, end, delta_time, arrivals.data());
+
+    for (size_t k = 0; k < arrived; ++k) {
+        arrive(arrivals[k], topology);
+    }
+}
+
+void VehicleStore::arrive(size_t i, const Topology& topology) {
+    const auto& route = topology.route(route_index[i]);
+    const int stop_count = static_cast<int>(route.stop_indices.size());
+
+    // Move to next stop
+    if (forward[i]) {
+        stop_idx[i]++;
+        if (stop_idx[i] >= stop_count) {
+            // Loop back to start
+            stop_idx[i] = 0;
+        }
+    } else {
+        stop_idx[i]--;
+        if (stop_idx[i] < 0) {
+            stop_idx[i] = stop_count - 1;
+        }
+    }
+
+    // Arrived at stop: snap exactly onto it, whatever the overshoot was
+    const auto& stop = topology.stop(route.stop_indices[stop_idx[i]]);
+    x[i] = stop.x;
+    y[i] = stop.y;
+    const VehicleTypeParams& type = (*types_)[kind[i]];
+    dwell[i] = type.dwell_mean + type.dwell_spread * nextSymmetric(rng[i]);
+    velocity[i] = departureVelocity(i);
+
+    enterSegment(i, topology);
+}
+
+void VehicleStore::enterSegment(size_t i, const Topology& topology) {
+    const auto& route = topology.route(route_index[i]);
+    const int stop_count = static_cast<int>(route.segments.size());
+
+    if (forward[i]) {
+        const Segment& segment = route.segments[stop_idx[i]];
+        start_x[i] = segment.start_x;
+        start_y[i] = segment.start_y;
+        dir_x[i] = segment.dir_x;
+        dir_y[i] = segment.dir_y;
+        length[i] = segment.length;
+        inv_length[i] = segment.inv_length;
+    } else {
+        // Backwards along the segment that ends at the current stop
+        const Segment& segment = route.segments[(stop_idx[i] - 1 + stop_count) % stop_count];
+        start_x[i] = segment.end_x;
+        start_y[i] = segment.end_y;
+        dir_x[i] = -segment.dir_x;
+        dir_y[i] = -segment.dir_y;
+        length[i] = segment.length;
+        inv_length[i] = segment.inv_length;
+    }
+    travelled[i] = 0.0;
+    progress[i] = 0.0;
+}
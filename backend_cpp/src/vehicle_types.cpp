@@ -0,0 +1,57 @@
+#include "vehicle_types.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// m/s^2 -> km/h per second
+const double kKmhPerMetrePerSecond = 3.6;
+
+} // namespace
+
+std::shared_ptr<const VehicleTypes> VehicleTypes::load(Database& db) {
+    return build(db.getAllVehicleTypes());
+}
+
+std::shared_ptr<const VehicleTypes> VehicleTypes::build(const std::vector<VehicleType>& rows) {
+    std::shared_ptr<VehicleTypes> types(new VehicleTypes());
+
+    types->params_.reserve(kVehicleKinds.size() + rows.size());
+    for (const auto& kind : kVehicleKinds) {
+        types->params_.push_back({std::string(kind.name), kind.dwell_time, kind.dwell_spread,
+                                  kind.speed_factor, kind.acceleration * kKmhPerMetrePerSecond,
+                                  kind.capacity});
+    }
+
+    for (const auto& row : rows) {
+        VehicleKind kind = types->kindOf(row.name);
+        if (types->params_[kind].name != row.name) {
+            if (types->params_.size() > std::numeric_limits<VehicleKind>::max()) {
+                std::cerr << "Too many vehicle types, ignoring '" << row.name << "'" << std::endl;
+                continue;
+            }
+            kind = static_cast<VehicleKind>(types->params_.size());
+            types->params_.emplace_back();
+        }
+
+        VehicleTypeParams& params = types->params_[kind];
+        params.name = row.name;
+        params.dwell_mean = std::max(kMinDwell, row.dwell_mean);
+        params.dwell_spread = std::min(std::max(0.0, row.dwell_spread), params.dwell_mean - kMinDwell);
+        params.speed_factor = std::max(0.0, row.speed_factor);
+        params.acceleration = std::max(0.0, row.acceleration) * kKmhPerMetrePerSecond;
+        params.capacity = row.capacity;
+    }
+
+    return types;
+}
+
+VehicleKind VehicleTypes::kindOf(std::string_view name) const {
+    for (size_t kind = 0; kind < params_.size(); ++kind) {
+        if (params_[kind].name == name) {
+            return static_cast<VehicleKind>(kind);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "worker_pool.h"
+#include <algorithm>
+
+namespace {
+
+uint64_t packRange(uint64_t head, uint64_t tail) {
+    return (head << 32) | tail;
+}
+
+} // namespace
+
+WorkerPool::WorkerPool(size_t threads) : queues_(std::max<size_t>(1, threads)) {
+    for (size_t w = 1; w < queues_.size(); ++w) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this, w);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const RangeFn& fn) {
+    if (count == 0) return;
+    grain = std::max<size_t>(1, grain);
+    size_t chunks = (count + grain - 1) / grain;
+    if (threads_.empty() || chunks == 1) {
+        fn(0, count);
+        return;
+    }
+
+    // Contiguous initial shares keep each worker on adjacent memory
+    size_t workers = queues_.size();
+    for (size_t w = 0; w < workers; ++w) {
+        queues_[w].range.store(packRange(w * chunks / workers, (w + 1) * chunks / workers));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        count_ = count;
+        grain_ = grain;
+        busy_workers_ = threads_.size();
+        ++generation_;
+    }
+    work_cv_.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+    fn_ = nullptr;
+}
+
+void WorkerPool::workerLoop(size_t worker) {
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return shutdown_ || generation_ != seen_generation; });
+            if (shutdown_) return;
+            seen_generation = generation_;
+        }
+
+        runChunks(worker);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_workers_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runChunks(size_t worker) {
+    auto run = [this](uint32_t chunk) {
+        size_t begin = chunk * grain_;
+        size_t end = std::min(count_, begin + grain_);
+        (*fn_)(begin, end);
+    };
+
+    uint32_t chunk;
+    while (popOwn(worker, chunk)) {
+        run(chunk);
+    }
+
+    // Queues only shrink during a job, so one pass over the victims is enough
+    size_t workers = queues_.size();
+    for (size_t i = 1; i < workers; ++i) {
+        size_t victim = (worker + i) % workers;
+        while (steal(victim, chunk)) {
+            run(chunk);
+        }
+    }
+}
+
+bool WorkerPool::popOwn(size_t worker, uint32_t& chunk) {
+    auto& range = queues_[worker].range;
+    uint64_t current = range.load();
+    while (true) {
+        uint64_t head = current >> 32;
+        uint64_t tail = current & 0xffffffffu;
+        if (head >= tail) return false;
+        if (range.compare_exchange_weak(current, packRange(head + 1, tail))) {
+            chunk = static_cast<uint32_t>(head);
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::steal(size_t victim, uint32_t& chunk) {
+    auto& range = queues_[victim].range;
+    uint64_t current = range.load();
+    while (true) {
+        uint64_t head = current >> 32;
+        uint64_t tail = current & 0xffffffffu;
+        if (head >= tail) return false;
+        if (range.compare_exchange_weak(current, packRange(head, tail - 1))) {
+            chunk = static_cast<uint32_t>(tail - 1);
+            return true;
+        }
+    }
+}